@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_AUTHORINGGUARD_HPP
+#define IGNITION_OMNIVERSE_AUTHORINGGUARD_HPP
+
+namespace ignition::omniverse
+{
+/// \brief Marks the changes made to the stage by the bridge itself.
+/// \details USD sends its notices from the thread that made the change,
+/// before the change returns. While a guard is alive in a thread, the notice
+/// listeners know that the changes come from the bridge and ignore them,
+/// instead of sending Ignition its own updates back. Guards can be nested.
+class AuthoringGuard
+{
+ public:
+  AuthoringGuard() : previous(active) { active = true; }
+
+  ~AuthoringGuard() { active = this->previous; }
+
+  AuthoringGuard(const AuthoringGuard&) = delete;
+  AuthoringGuard& operator=(const AuthoringGuard&) = delete;
+
+  /// \brief Whether the calling thread is authoring for the bridge
+  static bool Active() { return active; }
+
+ private:
+  bool previous;
+  static inline thread_local bool active = false;
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "CheckpointScheduler.hpp"
+
+#include <ignition/common/Console.hh>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace ignition::omniverse
+{
+class CheckpointScheduler::Implementation
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  ~Implementation();
+
+  void Worker();
+
+  /// \brief Ask the server once whether it supports checkpoints
+  bool Supported();
+
+  /// \brief Create a checkpoint, blocks until it is done
+  void Create(const std::string &_comment);
+
+  /// \brief Mark a checkpoint as due, `mutex` must be locked.
+  void Due(const std::string &_comment);
+
+  std::shared_ptr<StorageBackend> storage;
+  std::string stageUrl;
+  Options options;
+
+  /// \brief Only used by the worker
+  std::optional<bool> supported;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  /// \brief Comment of the checkpoint due, empty if none is due
+  std::string dueComment;
+  Clock::time_point nextInterval = Clock::time_point::max();
+  Clock::time_point lastCheckpoint;
+  std::optional<double> lastSimCheckpoint;
+  std::size_t created = 0;
+  std::size_t failed = 0;
+  std::size_t merged = 0;
+  std::string lastQuery;
+  bool stop = false;
+  // Keep it last, it uses the members above
+  std::thread worker;
+};
+
+//////////////////////////////////////////////////
+CheckpointScheduler::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->cv.notify_all();
+  if (this->worker.joinable())
+  {
+    this->worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void CheckpointScheduler::Implementation::Due(const std::string &_comment)
+{
+  if (this->dueComment.empty())
+  {
+    this->dueComment = _comment;
+  }
+  else
+  {
+    ++this->merged;
+  }
+}
+
+//////////////////////////////////////////////////
+void CheckpointScheduler::Implementation::Worker()
+{
+  while (true)
+  {
+    std::string comment;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      while (!this->stop)
+      {
+        const auto now = Clock::now();
+        if (now >= this->nextInterval)
+        {
+          this->Due("Periodic checkpoint");
+          this->nextInterval =
+              now + std::chrono::duration_cast<Clock::duration>(
+                      std::chrono::duration<double>(this->options.interval));
+        }
+        const auto earliest =
+            this->lastCheckpoint +
+            std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(this->options.minSpacing));
+        if (!this->dueComment.empty() && now >= earliest)
+        {
+          break;
+        }
+        // wake up for the next interval, or when the spacing allows the
+        // due checkpoint
+        auto wakeUp = this->nextInterval;
+        if (!this->dueComment.empty())
+        {
+          wakeUp = std::min(wakeUp, earliest);
+        }
+        if (wakeUp == Clock::time_point::max())
+        {
+          this->cv.wait(lock);
+        }
+        else
+        {
+          this->cv.wait_until(lock, wakeUp);
+        }
+      }
+      if (this->stop)
+      {
+        return;
+      }
+      comment.swap(this->dueComment);
+    }
+
+    this->Create(comment);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->lastCheckpoint = Clock::now();
+  }
+}
+
+//////////////////////////////////////////////////
+bool CheckpointScheduler::Implementation::Supported()
+{
+  if (!this->supported)
+  {
+    const auto info =
+        this->storage->ServerInfo(this->stageUrl)
+            .Get(std::chrono::milliseconds(this->options.timeoutMs));
+    if (!info)
+    {
+      // ask again next time
+      ignwarn << "Unable to get the server info of [" << this->stageUrl
+              << "]: " << omniClientGetResultString(info.Error())
+              << std::endl;
+      return false;
+    }
+    this->supported = info.Value().checkpointsEnabled;
+    if (!*this->supported)
+    {
+      ignwarn << "The server of [" << this->stageUrl
+              << "] doesn't support checkpoints" << std::endl;
+    }
+  }
+  return *this->supported;
+}
+
+//////////////////////////////////////////////////
+void CheckpointScheduler::Implementation::Create(const std::string &_comment)
+{
+  if (!this->Supported())
+  {
+    return;
+  }
+
+  const auto start = Clock::now();
+  const auto result =
+      this->storage->Checkpoint(this->stageUrl, _comment)
+          .Get(std::chrono::milliseconds(this->options.timeoutMs));
+  if (!result)
+  {
+    ignerr << "Unable to checkpoint [" << this->stageUrl
+           << "]: " << omniClientGetResultString(result.Error())
+           << std::endl;
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->failed;
+    return;
+  }
+
+  igndbg << "Checkpoint [" << this->stageUrl << result.Value() << "] ("
+         << _comment << ") in ["
+         << std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count()
+         << " ms]" << std::endl;
+  std::lock_guard<std::mutex> lock(this->mutex);
+  ++this->created;
+  this->lastQuery = result.Value();
+}
+
+//////////////////////////////////////////////////
+CheckpointScheduler::CheckpointScheduler(
+  std::shared_ptr<StorageBackend> _storage, const std::string &_stageUrl,
+  const Options &_options)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->storage = std::move(_storage);
+  this->dataPtr->stageUrl = _stageUrl;
+  this->dataPtr->options = _options;
+  const auto now = Implementation::Clock::now();
+  // the stage was just opened, it doesn't need a checkpoint right away
+  this->dataPtr->lastCheckpoint = now;
+  if (_options.interval > 0)
+  {
+    this->dataPtr->nextInterval =
+        now + std::chrono::duration_cast<Implementation::Clock::duration>(
+                std::chrono::duration<double>(_options.interval));
+  }
+  this->dataPtr->worker =
+      std::thread(&Implementation::Worker, this->dataPtr.get());
+}
+
+//////////////////////////////////////////////////
+CheckpointScheduler::~CheckpointScheduler() = default;
+
+//////////////////////////////////////////////////
+void CheckpointScheduler::Trigger(const std::string &_comment)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    this->dataPtr->Due(_comment.empty() ? "Checkpoint" : _comment);
+  }
+  this->dataPtr->cv.notify_one();
+}
+
+//////////////////////////////////////////////////
+void CheckpointScheduler::OnSimTime(double _simTime)
+{
+  if (this->dataPtr->options.simInterval <= 0)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto &last = this->dataPtr->lastSimCheckpoint;
+    // the simulation may have been reset
+    if (!last || _simTime < *last)
+    {
+      last = _simTime;
+      return;
+    }
+    if (_simTime - *last < this->dataPtr->options.simInterval)
+    {
+      return;
+    }
+    last = _simTime;
+    this->dataPtr->Due("Simulation time " + std::to_string(_simTime) + " s");
+  }
+  this->dataPtr->cv.notify_one();
+}
+
+//////////////////////////////////////////////////
+CheckpointScheduler::Stats CheckpointScheduler::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  Stats stats;
+  stats.created = this->dataPtr->created;
+  stats.failed = this->dataPtr->failed;
+  stats.merged = this->dataPtr->merged;
+  stats.lastCheckpoint = this->dataPtr->lastQuery;
+  return stats;
+}
+}  // namespace ignition::omniverse
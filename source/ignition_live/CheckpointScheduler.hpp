@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_CHECKPOINTSCHEDULER_HPP
+#define IGNITION_OMNIVERSE_CHECKPOINTSCHEDULER_HPP
+
+#include "StorageBackend.hpp"
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Creates checkpoints of the stage from a dedicated thread.
+/// \details A checkpoint is due after a wall clock interval, after a
+/// simulation time interval, or when an event is triggered. Due
+/// checkpoints are merged, and two checkpoints are at least `minSpacing`
+/// apart. Whether the server supports checkpoints is asked once, before
+/// the first one. The scheduler never touches the stage, it checkpoints
+/// the last version saved to the server.
+class CheckpointScheduler
+{
+ public:
+  struct Options
+  {
+    /// \brief Seconds of wall clock time between checkpoints, 0 disables
+    /// it.
+    double interval = 0;
+
+    /// \brief Seconds of simulation time between checkpoints, 0 disables
+    /// it.
+    double simInterval = 0;
+
+    /// \brief Minimum seconds of wall clock time between two checkpoints
+    double minSpacing = 10;
+
+    /// \brief Timeout of each request to the server, in milliseconds
+    unsigned int timeoutMs = 10000;
+  };
+
+  struct Stats
+  {
+    std::size_t created = 0;
+    std::size_t failed = 0;
+    /// \brief Triggers merged into a checkpoint already due
+    std::size_t merged = 0;
+    /// \brief Query of the last checkpoint created
+    std::string lastCheckpoint;
+  };
+
+  /// \param[in] _storage storage of the stage
+  /// \param[in] _stageUrl url of the stage to checkpoint
+  CheckpointScheduler(std::shared_ptr<StorageBackend> _storage,
+                      const std::string& _stageUrl, const Options& _options);
+
+  /// \brief Waits for the checkpoint in progress, if any.
+  ~CheckpointScheduler();
+
+  /// \brief Request a checkpoint, returns immediately.
+  /// \param[in] _comment comment of the checkpoint
+  void Trigger(const std::string& _comment);
+
+  /// \brief Report the current simulation time, returns immediately.
+  /// \param[in] _simTime simulation time in seconds
+  void OnSimTime(double _simTime);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
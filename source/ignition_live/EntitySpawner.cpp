@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "EntitySpawner.hpp"
+
+#include "Metrics.hpp"
+
+#include <ignition/common/Console.hh>
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/transport/Node.hh>
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace ignition::omniverse
+{
+class EntitySpawner::Implementation
+{
+ public:
+  ~Implementation();
+
+  void Worker();
+
+  ignition::transport::Node node;
+  std::string service;
+  std::size_t maxBatch = 64;
+  unsigned int timeoutMs = 5000;
+  std::thread worker;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  /// \brief Latest entity submitted with each name
+  std::map<std::string, ignition::msgs::EntityFactory> pending;
+  std::size_t submitted = 0;
+  std::size_t merged = 0;
+  std::size_t spawned = 0;
+  std::size_t failed = 0;
+  std::size_t requests = 0;
+  std::size_t failedRequests = 0;
+  bool stop = false;
+
+  DurationStat roundTrip;
+};
+
+//////////////////////////////////////////////////
+EntitySpawner::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->cv.notify_all();
+  if (this->worker.joinable())
+  {
+    this->worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void EntitySpawner::Implementation::Worker()
+{
+  while (true)
+  {
+    ignition::msgs::EntityFactory_V req;
+    std::size_t remaining = 0;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock,
+                    [this] { return this->stop || !this->pending.empty(); });
+      if (this->stop)
+      {
+        return;
+      }
+      auto it = this->pending.begin();
+      while (it != this->pending.end() &&
+             static_cast<std::size_t>(req.data_size()) < this->maxBatch)
+      {
+        *req.add_data() = std::move(it->second);
+        it = this->pending.erase(it);
+      }
+      remaining = this->pending.size();
+      ++this->requests;
+    }
+
+    bool result = false;
+    ignition::msgs::Boolean rep;
+    const auto start = DurationStat::Clock::now();
+    const bool executed = this->node.Request(
+      this->service, req, this->timeoutMs, rep, result);
+    if (executed)
+    {
+      this->roundTrip.Add(DurationStat::Clock::now() - start);
+    }
+
+    if (executed && result && rep.data())
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->spawned += req.data_size();
+      ignmsg << "Spawned [" << req.data_size() << "] models in Ignition, ["
+             << remaining << "] left" << std::endl;
+      continue;
+    }
+
+    if (executed)
+    {
+      ignerr << "Service [" << this->service << "] failed to spawn ["
+             << req.data_size() << "] models" << std::endl;
+    }
+    else
+    {
+      ignerr << "Service [" << this->service << "] call timed out, ["
+             << req.data_size() << "] models were not spawned" << std::endl;
+    }
+    for (const auto &entity : req.data())
+    {
+      igndbg << "Model was not inserted [" << entity.name() << "]"
+             << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->failedRequests;
+    this->failed += req.data_size();
+  }
+}
+
+//////////////////////////////////////////////////
+EntitySpawner::EntitySpawner(const std::string &_worldName,
+                             std::size_t _maxBatch, unsigned int _timeoutMs)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->service = "/world/" + _worldName + "/create_multiple";
+  this->dataPtr->maxBatch = std::max<std::size_t>(_maxBatch, 1);
+  this->dataPtr->timeoutMs = _timeoutMs;
+  this->dataPtr->worker =
+      std::thread(&Implementation::Worker, this->dataPtr.get());
+}
+
+//////////////////////////////////////////////////
+EntitySpawner::~EntitySpawner() = default;
+
+//////////////////////////////////////////////////
+void EntitySpawner::Submit(const ignition::msgs::EntityFactory &_entity)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto [it, inserted] =
+        this->dataPtr->pending.insert_or_assign(_entity.name(), _entity);
+    if (!inserted)
+    {
+      ++this->dataPtr->merged;
+    }
+    ++this->dataPtr->submitted;
+  }
+  this->dataPtr->cv.notify_one();
+}
+
+//////////////////////////////////////////////////
+EntitySpawner::Stats EntitySpawner::GetStats() const
+{
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    stats.submitted = this->dataPtr->submitted;
+    stats.merged = this->dataPtr->merged;
+    stats.spawned = this->dataPtr->spawned;
+    stats.failed = this->dataPtr->failed;
+    stats.pending = this->dataPtr->pending.size();
+    stats.requests = this->dataPtr->requests;
+    stats.failedRequests = this->dataPtr->failedRequests;
+  }
+  stats.meanRoundTripMs = this->dataPtr->roundTrip.MeanMs();
+  stats.maxRoundTripMs = this->dataPtr->roundTrip.MaxMs();
+  return stats;
+}
+}  // namespace ignition::omniverse
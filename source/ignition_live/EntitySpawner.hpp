@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_ENTITYSPAWNER_HPP
+#define IGNITION_OMNIVERSE_ENTITYSPAWNER_HPP
+
+#include <ignition/msgs/entity_factory.pb.h>
+#include <ignition/utils/ImplPtr.hh>
+
+#include <cstddef>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Spawns entities in Ignition from a dedicated thread.
+/// \details Entities are submitted without blocking. Those submitted while
+/// a request is running are sent together in the next request to
+/// "/world/<world>/create_multiple", at most `_maxBatch` per request. An
+/// entity submitted again before being sent replaces the previous one.
+class EntitySpawner
+{
+ public:
+  struct Stats
+  {
+    /// \brief Entities submitted
+    std::size_t submitted = 0;
+    /// \brief Entities replaced by a newer one with the same name before
+    /// being sent
+    std::size_t merged = 0;
+    /// \brief Entities of the requests that succeeded
+    std::size_t spawned = 0;
+    /// \brief Entities of the requests that failed or timed out
+    std::size_t failed = 0;
+    /// \brief Entities waiting for the next request
+    std::size_t pending = 0;
+    std::size_t requests = 0;
+    std::size_t failedRequests = 0;
+    /// \brief Time from sending a request until its response
+    double meanRoundTripMs = 0;
+    double maxRoundTripMs = 0;
+  };
+
+  /// \param[in] _worldName entities are spawned in this world
+  /// \param[in] _maxBatch maximum number of entities of a request
+  /// \param[in] _timeoutMs timeout of a request
+  EntitySpawner(const std::string& _worldName, std::size_t _maxBatch = 64,
+                unsigned int _timeoutMs = 5000);
+
+  /// \brief Waits for the request in flight, the pending entities are
+  /// dropped.
+  ~EntitySpawner();
+
+  /// \brief Queue an entity to spawn, returns immediately.
+  void Submit(const ignition::msgs::EntityFactory& _entity);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -14,14 +14,28 @@
  * limitations under the License.
  *
  */
-
 #include "FUSDLayerNoticeListener.hpp"
 
+#include "AuthoringGuard.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/entity.pb.h>
 #include <ignition/transport/Node.hh>
 
+#include <pxr/base/tf/weakPtr.h>
+#include <pxr/usd/sdf/changeBlock.h>
+
 namespace ignition
 {
 namespace omniverse
@@ -29,18 +43,280 @@ namespace omniverse
 class FUSDLayerNoticeListener::Implementation
 {
 public:
+  /// \brief Responses that arrived after their batch timed out. Shared
+  /// with the request callbacks, which may outlive the listener.
+  struct LateResponses
+  {
+    std::mutex mutex;
+    /// \brief Requests of the timed out batches still without a response
+    std::size_t waiting = 0;
+    std::vector<pxr::SdfPath> removed;
+  };
+
+  /// \brief Responses of the requests of a batch. Shared with the request
+  /// callbacks, which may run after the batch timed out.
+  struct Batch
+  {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t waiting = 0;
+    /// \brief The responses that arrive from now on go to `late`
+    bool timedOut = false;
+    std::shared_ptr<LateResponses> late;
+    std::vector<pxr::SdfPath> removed;
+    std::vector<pxr::SdfPath> failed;
+  };
+
+  ~Implementation();
+
+  /// \brief Queue the removal of a prim, unless one of its ancestors is
+  /// queued already. The queued removals of its descendants are dropped.
+  /// The caller must hold `mutex`.
+  void Queue(const pxr::SdfPath &_path, const ignition::msgs::Entity &_entity);
+
+  void Worker();
+
+  /// \brief Send the removals of a batch and update the bookkeeping of the
+  /// models removed
+  void RemoveBatch(
+    const std::map<pxr::SdfPath, ignition::msgs::Entity> &_batch);
+
+  /// \brief Update the bookkeeping of the models removed after their batch
+  /// timed out
+  void RemoveLate();
+
+  /// \brief Remove the prims of models removed from Ignition from the edit
+  /// target and from the roles
+  void RemovePrims(const std::vector<pxr::SdfPath> &_paths);
+
   std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> stage;
   std::string worldName;
   ignition::transport::Node node;
+  std::shared_ptr<PrimRoles> roles;
+  unsigned int timeoutMs = 5000;
+  std::shared_ptr<LateResponses> late = std::make_shared<LateResponses>();
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  /// \brief Removals waiting for the next batch, ordered by path so that
+  /// the descendants of a prim are contiguous
+  std::map<pxr::SdfPath, ignition::msgs::Entity> pending;
+  std::size_t submitted = 0;
+  std::size_t skipped = 0;
+  std::size_t removed = 0;
+  std::size_t failed = 0;
+  std::size_t batches = 0;
+  bool stop = false;
+  // Keep it last, it uses the members above
+  std::thread worker;
 };
 
+FUSDLayerNoticeListener::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->cv.notify_all();
+  if (this->worker.joinable())
+  {
+    this->worker.join();
+  }
+}
+
+void FUSDLayerNoticeListener::Implementation::Queue(
+  const pxr::SdfPath &_path, const ignition::msgs::Entity &_entity)
+{
+  for (auto parent = _path.GetParentPath(); !parent.IsEmpty();
+       parent = parent.GetParentPath())
+  {
+    if (this->pending.count(parent) > 0)
+    {
+      ++this->skipped;
+      return;
+    }
+  }
+
+  auto it = this->pending.lower_bound(_path);
+  while (it != this->pending.end() && it->first.HasPrefix(_path))
+  {
+    it = this->pending.erase(it);
+    ++this->skipped;
+  }
+  this->pending.emplace(_path, _entity);
+  ++this->submitted;
+}
+
+void FUSDLayerNoticeListener::Implementation::Worker()
+{
+  while (true)
+  {
+    std::map<pxr::SdfPath, ignition::msgs::Entity> batch;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      auto ready = [this] { return this->stop || !this->pending.empty(); };
+      bool lateResponses = false;
+      {
+        std::lock_guard<std::mutex> lateLock(this->late->mutex);
+        lateResponses = this->late->waiting > 0 || !this->late->removed.empty();
+      }
+      // the callbacks can't wake the worker, check the late responses at
+      // the rate of the timeout while there may be some
+      if (lateResponses)
+      {
+        this->cv.wait_for(lock, std::chrono::milliseconds(this->timeoutMs),
+                          ready);
+      }
+      else
+      {
+        this->cv.wait(lock, ready);
+      }
+      if (this->stop)
+      {
+        return;
+      }
+      batch.swap(this->pending);
+    }
+    this->RemoveLate();
+    if (!batch.empty())
+    {
+      this->RemoveBatch(batch);
+    }
+  }
+}
+
+void FUSDLayerNoticeListener::Implementation::RemoveBatch(
+  const std::map<pxr::SdfPath, ignition::msgs::Entity> &_batch)
+{
+  const std::string service = "/world/" + this->worldName + "/remove";
+  auto batch = std::make_shared<Batch>();
+  batch->waiting = _batch.size();
+  batch->late = this->late;
+  for (const auto &[path, entity] : _batch)
+  {
+    std::function<void(const ignition::msgs::Boolean &, const bool)>
+      callback = [batch, path = path](const ignition::msgs::Boolean &_rep,
+                           const bool _result)
+      {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        if (batch->timedOut)
+        {
+          // the batch is done, leave the bookkeeping to the next one
+          std::lock_guard<std::mutex> lateLock(batch->late->mutex);
+          --batch->late->waiting;
+          if (_result && _rep.data())
+          {
+            batch->late->removed.push_back(path);
+          }
+          return;
+        }
+        if (_result && _rep.data())
+        {
+          batch->removed.push_back(path);
+        }
+        else
+        {
+          batch->failed.push_back(path);
+        }
+        --batch->waiting;
+        batch->cv.notify_all();
+      };
+    if (!this->node.Request(service, entity, callback))
+    {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      batch->failed.push_back(path);
+      --batch->waiting;
+    }
+  }
+
+  std::vector<pxr::SdfPath> removedPaths;
+  std::size_t failedCount = 0;
+  {
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->cv.wait_for(lock, std::chrono::milliseconds(this->timeoutMs),
+                       [&batch] { return batch->waiting == 0; });
+    removedPaths = batch->removed;
+    failedCount = batch->failed.size() + batch->waiting;
+    for (const auto &path : batch->failed)
+    {
+      ignerr << "Error model was not removed [" << path.GetName() << "]"
+             << std::endl;
+    }
+    if (batch->waiting > 0)
+    {
+      ignerr << "Service [" << service << "] call timed out, ["
+             << batch->waiting << "] models may not be removed" << std::endl;
+      batch->timedOut = true;
+      std::lock_guard<std::mutex> lateLock(this->late->mutex);
+      this->late->waiting += batch->waiting;
+    }
+  }
+
+  this->RemovePrims(removedPaths);
+  ignmsg << "Removed [" << removedPaths.size() << "] models from Ignition, ["
+         << failedCount << "] failed" << std::endl;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->removed += removedPaths.size();
+  this->failed += failedCount;
+  ++this->batches;
+}
+
+void FUSDLayerNoticeListener::Implementation::RemoveLate()
+{
+  std::vector<pxr::SdfPath> removedPaths;
+  {
+    std::lock_guard<std::mutex> lock(this->late->mutex);
+    removedPaths.swap(this->late->removed);
+  }
+  if (removedPaths.empty())
+  {
+    return;
+  }
+
+  this->RemovePrims(removedPaths);
+  ignmsg << "Removed [" << removedPaths.size() << "] models from Ignition "
+         << "after the timeout" << std::endl;
+
+  // they were counted as failed when their batch timed out
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->removed += removedPaths.size();
+  this->failed -= std::min(this->failed, removedPaths.size());
+}
+
+void FUSDLayerNoticeListener::Implementation::RemovePrims(
+  const std::vector<pxr::SdfPath> &_paths)
+{
+  if (_paths.empty())
+  {
+    return;
+  }
+
+  // the prims are gone from the layer of the client that deleted them,
+  // remove them from the edit target too
+  auto stage = this->stage->Lock();
+  AuthoringGuard authoring;
+  pxr::SdfChangeBlock changeBlock;
+  for (const auto &path : _paths)
+  {
+    (*stage)->RemovePrim(path);
+    this->roles->Remove(path);
+  }
+}
+
 FUSDLayerNoticeListener::FUSDLayerNoticeListener(
   std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> &_stage,
-  const std::string& _worldName)
+  const std::string& _worldName,
+  std::shared_ptr<PrimRoles> _roles,
+  unsigned int _timeoutMs)
     : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
 {
   this->dataPtr->stage = _stage;
   this->dataPtr->worldName = _worldName;
+  this->dataPtr->roles = std::move(_roles);
+  this->dataPtr->timeoutMs = _timeoutMs;
+  this->dataPtr->worker =
+      std::thread(&Implementation::Worker, this->dataPtr.get());
 }
 
 void FUSDLayerNoticeListener::HandleGlobalLayerReload(
@@ -54,44 +330,65 @@ void FUSDLayerNoticeListener::HandleRootOrSubLayerChange(
     const class pxr::SdfNotice::LayersDidChangeSentPerLayer& _layerNotice,
     const pxr::TfWeakPtr<pxr::SdfLayer>& _sender)
 {
-  auto iter = _layerNotice.find(_sender);
-  for (auto & changeEntry : iter->second.GetEntryList())
+  // changes made by the bridge come from Ignition already
+  if (AuthoringGuard::Active())
   {
-    const pxr::SdfPath& sdfPath = changeEntry.first;
+    return;
+  }
 
-    if (changeEntry.second.flags.didRemoveNonInertPrim)
+  auto iter = _layerNotice.find(_sender);
+  std::size_t queued = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    for (auto & changeEntry : iter->second.GetEntryList())
     {
-      ignition::msgs::Entity req;
-      req.set_name(sdfPath.GetName());
-      req.set_type(ignition::msgs::Entity::MODEL);
-
-      ignition::msgs::Boolean rep;
-      bool result;
-      unsigned int timeout = 5000;
-      bool executed = this->dataPtr->node.Request(
-        "/world/" + this->dataPtr->worldName + "/remove",
-        req, timeout, rep, result);
-      if (executed)
+      const pxr::SdfPath& sdfPath = changeEntry.first;
+
+      if (changeEntry.second.flags.didRemoveNonInertPrim)
       {
-        if (rep.data())
+        ignmsg << "Deleted " << sdfPath.GetName() << std::endl;
+
+        ignition::msgs::Entity req;
+        req.set_name(sdfPath.GetName());
+        req.set_type(ignition::msgs::Entity::MODEL);
+
+        // links, visuals... of the entities can't be removed on their own
+        const auto role = this->dataPtr->roles->Find(sdfPath);
+        if (role && role->role != PrimRole::Model)
         {
-          igndbg << "Model was removed [" << sdfPath.GetName() << "]"
-                 << std::endl;
-          this->dataPtr->stage->Lock()->RemovePrim(sdfPath);
+          ++this->dataPtr->skipped;
+          continue;
         }
-        else
+        if (role)
         {
-          ignerr << "Error model was not removed [" << sdfPath.GetName()
-                 << "]" << std::endl;
+          req.set_id(role->entityId);
         }
+        this->dataPtr->Queue(sdfPath, req);
+        ++queued;
+      }
+      else if (changeEntry.second.flags.didAddNonInertPrim)
+      {
+        ignmsg << "Added" << sdfPath.GetName() << std::endl;
       }
-      ignmsg << "Deleted " << sdfPath.GetName() << std::endl;
-    }
-    else if (changeEntry.second.flags.didAddNonInertPrim)
-    {
-      ignmsg << "Added" << sdfPath.GetName() << std::endl;
     }
   }
+  if (queued > 0)
+  {
+    this->dataPtr->cv.notify_one();
+  }
+}
+
+FUSDLayerNoticeListener::Stats FUSDLayerNoticeListener::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  Stats stats;
+  stats.submitted = this->dataPtr->submitted;
+  stats.skipped = this->dataPtr->skipped;
+  stats.removed = this->dataPtr->removed;
+  stats.failed = this->dataPtr->failed;
+  stats.pending = this->dataPtr->pending.size();
+  stats.batches = this->dataPtr->batches;
+  return stats;
 }
 
 }
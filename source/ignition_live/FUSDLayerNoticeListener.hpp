@@ -17,6 +17,7 @@
 #ifndef IGNITION_OMNIVERSE_FUSDLAYERNOTICELISTENER_HPP
 #define IGNITION_OMNIVERSE_FUSDLAYERNOTICELISTENER_HPP
 
+#include "PrimRoles.hpp"
 #include "Scene.hpp"
 
 #include "ThreadSafe.hpp"
@@ -27,16 +28,47 @@
 
 #include <ignition/utils/ImplPtr.hh>
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 namespace ignition
 {
 namespace omniverse
 {
+/// \brief Removes from Ignition the models deleted by other clients of the
+/// stage.
+/// \details The removals of a notice are only queued. A dedicated thread
+/// sends the queued removals together, without waiting for each response
+/// before sending the next request, then updates the stage and the roles
+/// of the prims once for the whole batch.
 class FUSDLayerNoticeListener : public pxr::TfWeakBase
 {
  public:
+  struct Stats
+  {
+    /// \brief Deleted prims queued for removal
+    std::size_t submitted = 0;
+    /// \brief Deleted prims whose ancestor was already queued, or that
+    /// aren't models
+    std::size_t skipped = 0;
+    std::size_t removed = 0;
+    /// \brief Removals that failed or timed out. Those that succeed after
+    /// the timeout are moved to `removed`.
+    std::size_t failed = 0;
+    /// \brief Removals waiting for the next batch
+    std::size_t pending = 0;
+    std::size_t batches = 0;
+  };
+
+  /// \param[in] _roles roles of the prims created by the bridge, the
+  /// removed prims are removed from it
+  /// \param[in] _timeoutMs time to wait for the responses of a batch
   FUSDLayerNoticeListener(
     std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> &_stage,
-    const std::string& _worldName);
+    const std::string& _worldName,
+    std::shared_ptr<PrimRoles> _roles,
+    unsigned int _timeoutMs = 5000);
 
   void HandleGlobalLayerReload(const pxr::SdfNotice::LayerDidReloadContent& n);
 
@@ -45,6 +77,8 @@ class FUSDLayerNoticeListener : public pxr::TfWeakBase
       const class pxr::SdfNotice::LayersDidChangeSentPerLayer& _layerNotice,
       const pxr::TfWeakPtr<pxr::SdfLayer>& _sender);
 
+  Stats GetStats() const;
+
   /// \internal
   /// \brief Private data pointer
   IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
@@ -16,25 +16,48 @@
  */
 #include "FUSDNoticeListener.hpp"
 
-#include "GetOp.hpp"
+#include "AuthoringGuard.hpp"
+
 
 #include <ignition/common/Console.hh>
+#include <ignition/common/Filesystem.hh>
+#include <ignition/common/Util.hh>
+#include <ignition/math/Helpers.hh>
+#include <ignition/math/Pose3.hh>
 
 #include <pxr/usd/sdf/path.h>
 #include <pxr/usd/usd/notice.h>
 #include <pxr/usd/usd/primRange.h>
-#include <pxr/usd/usdGeom/sphere.h>
+#include <pxr/usd/usdGeom/capsule.h>
 #include <pxr/usd/usdGeom/cube.h>
 #include <pxr/usd/usdGeom/cylinder.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/sphere.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
 
 #include <ignition/transport/Node.hh>
 
+#include <ignition/msgs/joint_trajectory.pb.h>
 #include <ignition/msgs/model.pb.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <sdf/Box.hh>
+#include <sdf/Capsule.hh>
 #include <sdf/Collision.hh>
+#include <sdf/Cylinder.hh>
 #include <sdf/Geometry.hh>
 #include <sdf/Root.hh>
 #include <sdf/Link.hh>
+#include <sdf/Mesh.hh>
 #include <sdf/Model.hh>
 #include <sdf/Sphere.hh>
 #include <sdf/Visual.hh>
@@ -48,120 +71,391 @@ class FUSDNoticeListener::Implementation
 {
 public:
 
-  void ParseCube(const pxr::UsdPrim &_prim, sdf::Link &_link);
-  void ParseCylinder(const pxr::UsdPrim &_prim, sdf::Link &_link);
-  void ParseSphere(const pxr::UsdPrim &_prim, sdf::Link &_link);
-
-  bool ParsePrim(const pxr::UsdPrim &_prim, sdf::Link &_link)
+  bool ParseCube(const pxr::UsdPrim &_prim,
+                 const ignition::math::Vector3d &_scale,
+                 sdf::Geometry &_geom, ignition::math::Quaterniond &_axis);
+  bool ParseCylinder(const pxr::UsdPrim &_prim,
+                     const ignition::math::Vector3d &_scale,
+                     sdf::Geometry &_geom, ignition::math::Quaterniond &_axis);
+  bool ParseCapsule(const pxr::UsdPrim &_prim,
+                    const ignition::math::Vector3d &_scale,
+                    sdf::Geometry &_geom, ignition::math::Quaterniond &_axis);
+  bool ParseSphere(const pxr::UsdPrim &_prim,
+                   const ignition::math::Vector3d &_scale,
+                   sdf::Geometry &_geom, ignition::math::Quaterniond &_axis);
+
+  /// \brief Mesh of a model to spawn, exported once the stage is unlocked
+  struct PendingMesh
   {
-    if (_prim.IsA<pxr::UsdGeomSphere>())
-    {
-      ParseSphere(_prim, _link);
-      return true;
-    }
-    else if (_prim.IsA<pxr::UsdGeomCylinder>())
-    {
-      ParseCylinder(_prim, _link);
-    }
-    return false;
-  }
-
-  void CreateSDF(sdf::Link &_link, const pxr::UsdPrim &_prim)
+    MeshExporter::Geometry geometry;
+    /// \brief Name of the visual and collision, without their suffix
+    std::string name;
+    ignition::math::Pose3d pose;
+    ignition::math::Vector3d scale;
+  };
+
+  /// \brief Model added by another client, waiting for its meshes
+  struct PendingModel
+  {
+    sdf::Model model;
+    /// \brief Single link of the model, without the meshes
+    sdf::Link link;
+    std::vector<PendingMesh> meshes;
+  };
+
+  /// \brief Add a visual and a collision to a link for a geometry prim,
+  /// meshes are only read and added to `_model.meshes`
+  /// \param[in] _prim prim to convert
+  /// \param[in] _rootToWorld transform of the link, without scale
+  /// \return false if the prim is not a supported geometry
+  bool ParsePrim(const pxr::UsdPrim &_prim, const pxr::GfMatrix4d &_rootToWorld,
+                 pxr::UsdGeomXformCache &_xformCache, PendingModel &_model);
+
+  /// \brief Add all the geometries of a subtree to a model
+  /// \param[in] _rootToWorld transform of the link, without scale
+  void CreateSDF(PendingModel &_model, const pxr::UsdPrim &_prim,
+                 const pxr::GfMatrix4d &_rootToWorld,
+                 pxr::UsdGeomXformCache &_xformCache)
   {
     if (!_prim)
       return;
-    if (ParsePrim(_prim, _link))
+    for (const pxr::UsdPrim &prim : pxr::UsdPrimRange(_prim))
     {
-      return;
-    }
-    else
-    {
-      auto children = _prim.GetChildren();
-      for (const pxr::UsdPrim &childPrim : children)
-      {
-        if (ParsePrim(childPrim, _link))
-        {
-          return;
-        }
-        else
-        {
-          CreateSDF(_link, childPrim);
-        }
-      }
+      ParsePrim(prim, _rootToWorld, _xformCache, _model);
     }
   }
 
+  /// \brief Export the meshes of a model and spawn it. This doesn't touch
+  /// the stage.
+  void Spawn(PendingModel &_model);
+
+  ~Implementation();
+
   void jointStateCb(const ignition::msgs::Model &_msg);
 
+  /// \brief Process the paths captured from the notices at a fixed rate
+  void ProcessLoop();
+
+  /// \brief Process the paths changed by one or more notices
+  void ProcessBatch(const std::set<pxr::SdfPath> &_resyncedPaths,
+                    const std::set<pxr::SdfPath> &_changedInfoOnlyPaths);
+
+  /// \brief Keep the registry of revolute joints in sync with the stage.
+  /// The first call walks the whole stage, later calls only walk the
+  /// subtrees of the resynced paths.
+  void UpdateJointRegistry(const pxr::UsdStageRefPtr &_stage,
+                           const std::set<pxr::SdfPath> &_resyncedPaths);
+
+  /// \brief Add the revolute joints of a subtree to the registry
+  void RegisterJoints(const pxr::UsdPrim &_root);
+
+  /// \brief Remove the joints at or below a path from the registry
+  void UnregisterJoints(const pxr::SdfPath &_path);
+
+  struct RevoluteJoint
+  {
+    std::string name;
+    transport::Node::Publisher publisher;
+  };
+
   std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> stage;
   std::string worldName;
-  std::unordered_map<std::string, transport::Node::Publisher> revoluteJointPublisher;
+
+  /// \brief Revolute joints of the stage, ordered by path so that the
+  /// joints of a subtree are contiguous.
+  std::map<pxr::SdfPath, RevoluteJoint> revoluteJoints;
+  bool jointRegistryInitialized = false;
 
   /// \brief Ignition communication node.
   public: transport::Node node;
 
   Simulator simulatorPoses;
 
+  JointCommands jointCommands = JointCommands::PerJoint;
+
+  /// \brief Publisher of the positions of all the joints, only with
+  /// `JointCommands::Trajectory`
+  transport::Node::Publisher trajectoryPublisher;
+
+  /// \brief Sends the poses to Ignition, only with IsaacSim poses
+  std::unique_ptr<PoseSender> poseSender;
+
+  /// \brief Spawns the models added by other clients in Ignition
+  std::unique_ptr<EntitySpawner> spawner;
+
+  /// \brief Exports the meshes of the models added by other clients
+  std::unique_ptr<MeshExporter> meshExporter;
+
   std::mutex jointStateMsgMutex;
   std::unordered_map<std::string, double> jointStateMap;
 
-  std::unordered_map<std::string, uint32_t> * entitiesByName;
+  /// \brief Roles of the prims created by the bridge
+  std::shared_ptr<const PrimRoles> roles;
+
+  /// \brief Paths captured from the notices since the last batch
+  mutable std::mutex captureMutex;
+  std::condition_variable captureCv;
+  std::set<pxr::SdfPath> resyncedPaths;
+  std::set<pxr::SdfPath> changedInfoOnlyPaths;
+  /// \brief Paths resynced by the bridge itself, they are not spawned or
+  /// posed again but the joints under them are registered
+  std::set<pxr::SdfPath> suppressedResyncedPaths;
+  std::size_t noticesReceived = 0;
+  std::size_t noticesProcessed = 0;
+  std::size_t noticesSuppressed = 0;
+  std::size_t batchesProcessed = 0;
+  std::size_t pathsProcessed = 0;
+  std::chrono::steady_clock::duration batchPeriod;
+  bool stop = false;
+  // Keep it last, it uses the members above
+  std::thread processThread;
 };
 
-void FUSDNoticeListener::Implementation::ParseCube(
-  const pxr::UsdPrim &_prim, sdf::Link &_link)
+/// \brief Pose and scale of a transform
+static ignition::math::Pose3d toPose(const pxr::GfMatrix4d &_transform,
+                                     ignition::math::Vector3d &_scale)
 {
-  // double size;
-  // auto variant_cylinder = pxr::UsdGeomCube(_prim);
-  // variant_cylinder.GetSizeAttr().Get(&size);
+  // the rows are the axes of the frame
+  _scale = ignition::math::Vector3d(_transform.GetRow3(0).GetLength(),
+                                    _transform.GetRow3(1).GetLength(),
+                                    _transform.GetRow3(2).GetLength());
+  const auto rigid = _transform.RemoveScaleShear();
+  const pxr::GfVec3d position = rigid.ExtractTranslation();
+  const pxr::GfQuatd rotation = rigid.ExtractRotationQuat().GetNormalized();
+  return ignition::math::Pose3d(
+    ignition::math::Vector3d(position[0], position[1], position[2]),
+    ignition::math::Quaterniond(rotation.GetReal(),
+                                rotation.GetImaginary()[0],
+                                rotation.GetImaginary()[1],
+                                rotation.GetImaginary()[2]));
 }
 
-void FUSDNoticeListener::Implementation::ParseCylinder(
-  const pxr::UsdPrim &_prim, sdf::Link &_link)
+/// \brief Rotation from the Z axis of SDF cylinders and capsules to the
+/// axis of a USD one, and their radial and axial scales
+static ignition::math::Quaterniond fromZAxis(
+  const pxr::TfToken &_axis, const ignition::math::Vector3d &_scale,
+  double &_radialScale, double &_axialScale)
 {
-  // auto variant_cylinder = pxr::UsdGeomCylinder(_prim);
-  // double radius;
-  // double height;
-  // variant_cylinder.GetRadiusAttr().Get(&radius);
-  // variant_cylinder.GetHeightAttr().Get(&height);
+  if (_axis == pxr::UsdGeomTokens->x)
+  {
+    _radialScale = std::max(_scale.Y(), _scale.Z());
+    _axialScale = _scale.X();
+    return ignition::math::Quaterniond(0, IGN_PI_2, 0);
+  }
+  if (_axis == pxr::UsdGeomTokens->y)
+  {
+    _radialScale = std::max(_scale.X(), _scale.Z());
+    _axialScale = _scale.Y();
+    return ignition::math::Quaterniond(-IGN_PI_2, 0, 0);
+  }
+  _radialScale = std::max(_scale.X(), _scale.Y());
+  _axialScale = _scale.Z();
+  return ignition::math::Quaterniond();
 }
 
-void FUSDNoticeListener::Implementation::ParseSphere(
-  const pxr::UsdPrim &_prim, sdf::Link &_link)
+/// \brief Add a visual and a collision with the same geometry to a link
+static void addGeometry(sdf::Link &_link, const std::string &_name,
+                        const ignition::math::Pose3d &_pose,
+                        const sdf::Geometry &_geom)
 {
-  double radius;
-  auto variant_sphere = pxr::UsdGeomSphere(_prim);
-  variant_sphere.GetRadiusAttr().Get(&radius);
-
   sdf::Visual visual;
+  visual.SetName(_name + "_visual");
+  visual.SetRawPose(_pose);
+  visual.SetGeom(_geom);
+
   sdf::Collision collision;
+  collision.SetName(_name + "_collision");
+  collision.SetRawPose(_pose);
+  collision.SetGeom(_geom);
+
+  _link.AddVisual(visual);
+  _link.AddCollision(collision);
+}
+
+bool FUSDNoticeListener::Implementation::ParsePrim(
+  const pxr::UsdPrim &_prim, const pxr::GfMatrix4d &_rootToWorld,
+  pxr::UsdGeomXformCache &_xformCache, PendingModel &_model)
+{
+  using ParseFn = bool (Implementation::*)(
+    const pxr::UsdPrim &, const ignition::math::Vector3d &, sdf::Geometry &,
+    ignition::math::Quaterniond &);
+  ParseFn parse = nullptr;
+  const bool isMesh = _prim.IsA<pxr::UsdGeomMesh>();
+  if (_prim.IsA<pxr::UsdGeomSphere>())
+    parse = &Implementation::ParseSphere;
+  else if (_prim.IsA<pxr::UsdGeomCube>())
+    parse = &Implementation::ParseCube;
+  else if (_prim.IsA<pxr::UsdGeomCapsule>())
+    parse = &Implementation::ParseCapsule;
+  else if (_prim.IsA<pxr::UsdGeomCylinder>())
+    parse = &Implementation::ParseCylinder;
+  else if (!isMesh)
+    return false;
+
+  // world = local * root, so local = world * root^-1
+  ignition::math::Vector3d scale;
+  const auto pose = toPose(
+    _xformCache.GetLocalToWorldTransform(_prim) * _rootToWorld.GetInverse(),
+    scale);
+
+  // geometries of different subtrees may have the same name
+  std::string name = _prim.GetPath().GetString();
+  std::replace(name.begin(), name.end(), '/', '_');
+
+  // writing the file of a mesh waits for the stage to be unlocked
+  if (isMesh)
+  {
+    _model.meshes.push_back(
+      {MeshExporter::Read(pxr::UsdGeomMesh(_prim)), name, pose, scale});
+    return true;
+  }
+
   sdf::Geometry geom;
+  ignition::math::Quaterniond axis;
+  if (!(this->*parse)(_prim, scale, geom, axis))
+    return false;
+
+  addGeometry(_model.link, name,
+              ignition::math::Pose3d(pose.Pos(), pose.Rot() * axis), geom);
+  return true;
+}
+
+bool FUSDNoticeListener::Implementation::ParseCube(
+  const pxr::UsdPrim &_prim, const ignition::math::Vector3d &_scale,
+  sdf::Geometry &_geom, ignition::math::Quaterniond &)
+{
+  double size = 2;
+  pxr::UsdGeomCube(_prim).GetSizeAttr().Get(&size);
+
+  sdf::Box box;
+  box.SetSize(ignition::math::Vector3d(
+    size * _scale.X(), size * _scale.Y(), size * _scale.Z()));
+  _geom.SetType(sdf::GeometryType::BOX);
+  _geom.SetBoxShape(box);
+  return true;
+}
+
+bool FUSDNoticeListener::Implementation::ParseCylinder(
+  const pxr::UsdPrim &_prim, const ignition::math::Vector3d &_scale,
+  sdf::Geometry &_geom, ignition::math::Quaterniond &_axis)
+{
+  auto variant_cylinder = pxr::UsdGeomCylinder(_prim);
+  double radius = 1;
+  double height = 2;
+  pxr::TfToken axis = pxr::UsdGeomTokens->z;
+  variant_cylinder.GetRadiusAttr().Get(&radius);
+  variant_cylinder.GetHeightAttr().Get(&height);
+  variant_cylinder.GetAxisAttr().Get(&axis);
+
+  double radialScale;
+  double axialScale;
+  _axis = fromZAxis(axis, _scale, radialScale, axialScale);
+
+  sdf::Cylinder cylinder;
+  cylinder.SetRadius(radius * radialScale);
+  cylinder.SetLength(height * axialScale);
+  _geom.SetType(sdf::GeometryType::CYLINDER);
+  _geom.SetCylinderShape(cylinder);
+  return true;
+}
+
+bool FUSDNoticeListener::Implementation::ParseCapsule(
+  const pxr::UsdPrim &_prim, const ignition::math::Vector3d &_scale,
+  sdf::Geometry &_geom, ignition::math::Quaterniond &_axis)
+{
+  auto variant_capsule = pxr::UsdGeomCapsule(_prim);
+  double radius = 0.5;
+  double height = 1;
+  pxr::TfToken axis = pxr::UsdGeomTokens->z;
+  variant_capsule.GetRadiusAttr().Get(&radius);
+  variant_capsule.GetHeightAttr().Get(&height);
+  variant_capsule.GetAxisAttr().Get(&axis);
+
+  double radialScale;
+  double axialScale;
+  _axis = fromZAxis(axis, _scale, radialScale, axialScale);
+
+  // the height of both is the length of the cylindrical part
+  sdf::Capsule capsule;
+  capsule.SetRadius(radius * radialScale);
+  capsule.SetLength(height * axialScale);
+  _geom.SetType(sdf::GeometryType::CAPSULE);
+  _geom.SetCapsuleShape(capsule);
+  return true;
+}
+
+bool FUSDNoticeListener::Implementation::ParseSphere(
+  const pxr::UsdPrim &_prim, const ignition::math::Vector3d &_scale,
+  sdf::Geometry &_geom, ignition::math::Quaterniond &)
+{
+  double radius = 1;
+  auto variant_sphere = pxr::UsdGeomSphere(_prim);
+  variant_sphere.GetRadiusAttr().Get(&radius);
+
   sdf::Sphere sphere;
+  sphere.SetRadius(radius * _scale.Max());
+  _geom.SetType(sdf::GeometryType::SPHERE);
+  _geom.SetSphereShape(sphere);
+  return true;
+}
+
+void FUSDNoticeListener::Implementation::Spawn(PendingModel &_model)
+{
+  for (const auto &pending : _model.meshes)
+  {
+    const auto exported = this->meshExporter->Export(pending.geometry);
+    if (!exported)
+    {
+      ignerr << exported.Error() << std::endl;
+      continue;
+    }
 
-  geom.SetType(sdf::GeometryType::SPHERE);
-  sphere.SetRadius(radius);
-  geom.SetSphereShape(sphere);
-  visual.SetName("sphere_visual");
-  visual.SetGeom(geom);
+    sdf::Mesh mesh;
+    mesh.SetUri(exported.Value());
+    mesh.SetScale(pending.scale);
+    sdf::Geometry geom;
+    geom.SetType(sdf::GeometryType::MESH);
+    geom.SetMeshShape(mesh);
+    addGeometry(_model.link, pending.name, pending.pose, geom);
+  }
 
-  collision.SetName("sphere_collision");
-  collision.SetGeom(geom);
+  _model.model.AddLink(_model.link);
+  sdf::Root root;
+  root.SetModel(_model.model);
 
-  _link.AddVisual(visual);
-  _link.AddCollision(collision);
+  ignition::msgs::EntityFactory req;
+  req.set_sdf(root.ToElement()->ToString(""));
+  req.set_name(_model.model.Name());
+  req.set_allow_renaming(false);
+
+  igndbg << "root.ToElement()->ToString("") " << req.sdf() << '\n';
+
+  this->spawner->Submit(req);
 }
 
 FUSDNoticeListener::FUSDNoticeListener(
   std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> &_stage,
   const std::string &_worldName,
   Simulator _simulatorPoses,
-  std::unordered_map<std::string, uint32_t> &_entitiesByName)
+  std::shared_ptr<const PrimRoles> _roles,
+  double _batchRate,
+  JointCommands _jointCommands)
     : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
 {
   this->dataPtr->stage = _stage;
   this->dataPtr->worldName = _worldName;
   this->dataPtr->simulatorPoses = _simulatorPoses;
-  this->dataPtr->entitiesByName = &_entitiesByName;
+  this->dataPtr->roles = std::move(_roles);
+  this->dataPtr->jointCommands = _jointCommands;
+  this->dataPtr->spawner = std::make_unique<EntitySpawner>(_worldName);
+  std::string home;
+  ignition::common::env("HOME", home);
+  this->dataPtr->meshExporter = std::make_unique<MeshExporter>(
+      ignition::common::joinPaths(home, ".ignition", "omniverse", "meshes"));
+  if (_simulatorPoses == Simulator::IsaacSim)
+  {
+    this->dataPtr->poseSender = std::make_unique<PoseSender>(_worldName);
+  }
 
   std::string jointStateTopic = "/joint_states";
 
@@ -169,6 +463,12 @@ FUSDNoticeListener::FUSDNoticeListener(
     jointStateTopic,
     &FUSDNoticeListener::Implementation::jointStateCb,
     this->dataPtr.get());
+
+  this->dataPtr->batchPeriod =
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1 / _batchRate));
+  this->dataPtr->processThread =
+      std::thread(&Implementation::ProcessLoop, this->dataPtr.get());
 }
 
 void FUSDNoticeListener::Implementation::jointStateCb(
@@ -182,137 +482,216 @@ void FUSDNoticeListener::Implementation::jointStateCb(
   }
 }
 
-void FUSDNoticeListener::Handle(
-  const class pxr::UsdNotice::ObjectsChanged &ObjectsChanged)
+void FUSDNoticeListener::Implementation::UpdateJointRegistry(
+  const pxr::UsdStageRefPtr &_stage,
+  const std::set<pxr::SdfPath> &_resyncedPaths)
 {
-  auto stage = this->dataPtr->stage->Lock();
+  if (!this->jointRegistryInitialized)
+  {
+    this->RegisterJoints(_stage->GetPseudoRoot());
+    this->jointRegistryInitialized = true;
+    igndbg << "Found [" << this->revoluteJoints.size()
+           << "] revolute joints" << std::endl;
+    return;
+  }
 
-  for (const pxr::SdfPath &objectsChanged : ObjectsChanged.GetResyncedPaths())
+  for (const pxr::SdfPath &path : _resyncedPaths)
   {
-    ignmsg << "Resynced Path: " << objectsChanged.GetText() << std::endl;
-    auto modelUSD = stage->GetPrimAtPath(objectsChanged);
-    std::string primName = modelUSD.GetName();
+    const auto primPath = path.GetPrimPath();
+    this->UnregisterJoints(primPath);
+    this->RegisterJoints(_stage->GetPrimAtPath(primPath));
+  }
+}
 
-    if (primName.find("ROS_") != std::string::npos ||
-        primName.find("PhysicsScene") != std::string::npos)
+void FUSDNoticeListener::Implementation::RegisterJoints(
+  const pxr::UsdPrim &_root)
+{
+  if (!_root)
+  {
+    return;
+  }
+
+  static const pxr::TfToken revoluteJointType("PhysicsRevoluteJoint");
+  for (const auto &prim : pxr::UsdPrimRange(_root))
+  {
+    if (prim.GetTypeName() != revoluteJointType ||
+        this->revoluteJoints.count(prim.GetPath()) > 0)
     {
       continue;
     }
+    auto &joint = this->revoluteJoints[prim.GetPath()];
+    joint.name = prim.GetName().GetString();
+    if (this->jointCommands == JointCommands::PerJoint)
+    {
+      const std::string topic = transport::TopicUtils::AsValidTopic(
+        std::string("/model/") + std::string("panda") +
+        std::string("/joint/") + prim.GetPath().GetName() +
+        std::string("/0/cmd_pos"));
+      joint.publisher = this->node.Advertise<msgs::Double>(topic);
+    }
+    else if (!this->trajectoryPublisher)
+    {
+      const std::string topic = transport::TopicUtils::AsValidTopic(
+        std::string("/model/") + std::string("panda") +
+        std::string("/joint_trajectory"));
+      this->trajectoryPublisher =
+          this->node.Advertise<msgs::JointTrajectory>(topic);
+    }
+  }
+}
+
+void FUSDNoticeListener::Implementation::UnregisterJoints(
+  const pxr::SdfPath &_path)
+{
+  auto it = this->revoluteJoints.lower_bound(_path);
+  while (it != this->revoluteJoints.end() && it->first.HasPrefix(_path))
+  {
+    it = this->revoluteJoints.erase(it);
+  }
+}
+
+const PoseSender *FUSDNoticeListener::Poses() const
+{
+  return this->dataPtr->poseSender.get();
+}
+
+const EntitySpawner *FUSDNoticeListener::Spawner() const
+{
+  return this->dataPtr->spawner.get();
+}
+
+const MeshExporter *FUSDNoticeListener::ExportedMeshes() const
+{
+  return this->dataPtr->meshExporter.get();
+}
 
-    if (modelUSD)
+/// \brief Whether a strict ancestor of a path is in a set of paths
+static bool hasResyncedAncestor(const pxr::SdfPath &_path,
+                                const std::set<pxr::SdfPath> &_paths)
+{
+  // a resync of the whole stage is not the one of a model
+  for (auto parent = _path.GetParentPath();
+       !parent.IsEmpty() && !parent.IsAbsoluteRootPath();
+       parent = parent.GetParentPath())
+  {
+    if (_paths.count(parent) > 0)
     {
-      std::string strPath = objectsChanged.GetText();
-      if (strPath.find("_link") != std::string::npos
-         || strPath.find("_visual") != std::string::npos
-         || strPath.find("geometry") != std::string::npos) {
-        return;
+      return true;
+    }
+  }
+  return false;
+}
+
+void FUSDNoticeListener::Implementation::ProcessBatch(
+  const std::set<pxr::SdfPath> &_resyncedPaths,
+  const std::set<pxr::SdfPath> &_changedInfoOnlyPaths)
+{
+  // the meshes are written and the models spawned once the stage is
+  // unlocked
+  std::vector<PendingModel> pendingModels;
+  {
+    auto stage = this->stage->Lock();
+
+    if (this->simulatorPoses == Simulator::IsaacSim)
+    {
+      this->UpdateJointRegistry(*stage, _resyncedPaths);
+    }
+
+    pxr::UsdGeomXformCache xformCache;
+    for (const pxr::SdfPath &objectsChanged : _resyncedPaths)
+    {
+      ignmsg << "Resynced Path: " << objectsChanged.GetText() << std::endl;
+      if (objectsChanged == pxr::SdfPath::AbsoluteRootPath())
+      {
+        continue;
       }
+      auto modelUSD = stage->GetPrimAtPath(objectsChanged);
+      std::string primName = modelUSD.GetName();
 
-      auto it = this->dataPtr->entitiesByName->find(modelUSD.GetName().GetString());
-      if (it != this->dataPtr->entitiesByName->end())
+      if (primName.find("ROS_") != std::string::npos ||
+          primName.find("PhysicsScene") != std::string::npos)
       {
         continue;
       }
 
-      auto range = pxr::UsdPrimRange::Stage(*stage);
-      for (auto const &prim : range)
+      if (modelUSD)
       {
-        if (prim.GetName().GetString() == primName)
+        // the subtree is already spawned with its resynced ancestor
+        if (hasResyncedAncestor(objectsChanged, _resyncedPaths))
         {
           continue;
         }
-      }
-
-      sdf::Root root;
-
-      sdf::Model model;
-
-      model.SetName(modelUSD.GetPath().GetName());
-
-      model.SetRawPose(ignition::math::Pose3d());
 
-      sdf::Link link;
-      link.SetName(modelUSD.GetPath().GetName());
-
-    	this->dataPtr->CreateSDF(link, modelUSD);
+        // prims of the entities, or added inside them, come from Ignition
+        if (!this->roles->FindOwner(objectsChanged).IsEmpty())
+        {
+          continue;
+        }
 
-      model.AddLink(link);
-      root.SetModel(model);
+        PendingModel pending;
+        auto &model = pending.model;
+        model.SetName(modelUSD.GetPath().GetName());
 
-    	// Prepare the input parameters.
-    	ignition::msgs::EntityFactory req;
-    	req.set_sdf(root.ToElement()->ToString(""));
-    	req.set_name(modelUSD.GetPath().GetName());
-    	req.set_allow_renaming(false);
+        // the geometries keep the scale of the model, the model itself can't
+        // be scaled
+        ignition::math::Vector3d scale;
+        const auto rootToWorld =
+            xformCache.GetLocalToWorldTransform(modelUSD).RemoveScaleShear();
+        model.SetRawPose(toPose(rootToWorld, scale));
 
-      igndbg << "root.ToElement()->ToString("") "
-             << root.ToElement()->ToString("") << '\n';
+        pending.link.SetName(modelUSD.GetPath().GetName());
 
-      ignition::msgs::Boolean rep;
-      bool result;
-      unsigned int timeout = 5000;
-      bool executed = this->dataPtr->node.Request(
-        "/world/" + this->dataPtr->worldName + "/create",
-        req, timeout, rep, result);
-    	if (executed)
-      {
-    		if (rep.data())
-    		{
-    			igndbg << "Model was inserted [" << modelUSD.GetPath().GetName()
-                    << "]" << '\n';
-    		}
-    		else
-    		{
-    			igndbg << "Error model was not inserted" << '\n';
-    		}
-    	}
+        this->CreateSDF(pending, modelUSD, rootToWorld, xformCache);
+        pendingModels.push_back(std::move(pending));
+      }
     }
   }
+  for (auto &pending : pendingModels)
+  {
+    this->Spawn(pending);
+  }
 
+  auto stage = this->stage->Lock();
+  pxr::UsdGeomXformCache xformCache;
   ignition::msgs::Pose_V req;
 
-  if (this->dataPtr->simulatorPoses == Simulator::IsaacSim)
+  if (this->simulatorPoses == Simulator::IsaacSim)
   {
-    // this loop checks all paths to find revolute joints
-    // if there is some, we get the body0 and body1 and calculate the
-    // joint angle.
-    auto range = pxr::UsdPrimRange::Stage(*stage);
+    // publish the latest state of every revolute joint
+    if (this->jointCommands == JointCommands::PerJoint)
     {
-      std::lock_guard<std::mutex> lock(this->dataPtr->jointStateMsgMutex);
-      for (auto const &prim : range)
+      std::lock_guard<std::mutex> lock(this->jointStateMsgMutex);
+      for (auto &[path, joint] : this->revoluteJoints)
       {
-        std::string primType = prim.GetPrimTypeInfo().GetTypeName().GetText();
-        if (primType == std::string("PhysicsRevoluteJoint"))
-        {
-              std::string topic = transport::TopicUtils::AsValidTopic(
-              std::string("/model/") + std::string("panda") +
-              std::string("/joint/") + prim.GetPath().GetName() +
-              std::string("/0/cmd_pos"));
-
-            auto pub = this->dataPtr->revoluteJointPublisher.find(topic);
-            if (pub == this->dataPtr->revoluteJointPublisher.end())
-            {
-              this->dataPtr->revoluteJointPublisher[topic] =
-                this->dataPtr->node.Advertise<msgs::Double>(topic);
-            }
-            else
-            {
-              msgs::Double cmd;
-              float pos = this->dataPtr->jointStateMap[prim.GetName()];
-              cmd.set_data(pos);
-              pub->second.Publish(cmd);
-            }
-        }
+        msgs::Double cmd;
+        float pos = this->jointStateMap[joint.name];
+        cmd.set_data(pos);
+        joint.publisher.Publish(cmd);
+      }
+    }
+    else if (!this->revoluteJoints.empty())
+    {
+      // a single point reached right away, with all the joints of the model
+      msgs::JointTrajectory cmd;
+      auto *point = cmd.add_points();
+      std::lock_guard<std::mutex> lock(this->jointStateMsgMutex);
+      for (const auto &[path, joint] : this->revoluteJoints)
+      {
+        cmd.add_joint_names(joint.name);
+        point->add_positions(this->jointStateMap[joint.name]);
       }
+      this->trajectoryPublisher.Publish(cmd);
     }
 
-    for (const pxr::SdfPath &objectsChanged :
-        ObjectsChanged.GetChangedInfoOnlyPaths())
+    for (const pxr::SdfPath &objectsChanged : _changedInfoOnlyPaths)
     {
       if (std::string(objectsChanged.GetText()) == "/")
         continue;
       igndbg << "path " << objectsChanged.GetText() << std::endl;
       auto modelUSD = stage->GetPrimAtPath(objectsChanged.GetParentPath());
+      // the prim may have been removed by a later notice of the batch
+      if (!modelUSD)
+        continue;
       auto property = modelUSD.GetPropertyAtPath(objectsChanged);
       std::string strProperty = property.GetBaseName().GetText();
       if (strProperty == "radius")
@@ -323,122 +702,157 @@ void FUSDNoticeListener::Handle(
       }
       if (strProperty == "translate")
       {
-        auto xform = pxr::UsdGeomXformable(modelUSD);
-
-        auto transforms = GetOp(xform);
+        // the pose is sent for the model of the entities, other prims are
+        // models of their own
         auto currentPrim = modelUSD;
-        ignition::math::Quaterniond q(
-          transforms.rotXYZ[0],
-          transforms.rotXYZ[1],
-          transforms.rotXYZ[2]);
-        if (currentPrim.GetName() == "geometry")
+        if (!this->roles->FindOwner(modelUSD.GetPath()).IsEmpty())
         {
-          currentPrim = currentPrim.GetParent();
-          auto visualXform = pxr::UsdGeomXformable(currentPrim);
-          auto visualOp = GetOp(visualXform);
-          transforms.position += visualOp.position;
-          ignition::math::Quaterniond qX, qY, qZ;
-          ignition::math::Angle angleX(IGN_DTOR(visualOp.rotXYZ[0]));
-          ignition::math::Angle angleY(IGN_DTOR(visualOp.rotXYZ[1]));
-          ignition::math::Angle angleZ(IGN_DTOR(visualOp.rotXYZ[2]));
-          qX = ignition::math::Quaterniond(angleX.Normalized().Radian(), 0, 0);
-          qY = ignition::math::Quaterniond(0, angleY.Normalized().Radian(), 0);
-          qZ = ignition::math::Quaterniond(0, 0, angleZ.Normalized().Radian());
-          q = ((q * qX) * qY) * qZ;
-          transforms.scale = pxr::GfVec3f(
-            transforms.scale[0] * visualOp.scale[0],
-            transforms.scale[1] * visualOp.scale[1],
-            transforms.scale[2] * visualOp.scale[2]);
-        }
-        auto currentPrimName = currentPrim.GetName().GetString();
-        int substrIndex = currentPrimName.size() - std::string("_visual").size();
-        if (substrIndex >= 0 && substrIndex < currentPrimName.size())
-        {
-          if (currentPrimName.substr(substrIndex).find("_visual") !=
-            std::string::npos)
+          const auto modelPath =
+              this->roles->FindAncestor(modelUSD.GetPath(), PrimRole::Model);
+          if (modelPath.IsEmpty())
           {
-            currentPrim = currentPrim.GetParent();
-            auto linkXform = pxr::UsdGeomXformable(currentPrim);
-            auto linkOp = GetOp(linkXform);
-            transforms.position += linkOp.position;
-            ignition::math::Quaterniond qX, qY, qZ;
-            ignition::math::Angle angleX(IGN_DTOR(linkOp.rotXYZ[0]));
-            ignition::math::Angle angleY(IGN_DTOR(linkOp.rotXYZ[1]));
-            ignition::math::Angle angleZ(IGN_DTOR(linkOp.rotXYZ[2]));
-            qX = ignition::math::Quaterniond(angleX.Normalized().Radian(), 0, 0);
-            qY = ignition::math::Quaterniond(0, angleY.Normalized().Radian(), 0);
-            qZ = ignition::math::Quaterniond(0, 0, angleZ.Normalized().Radian());
-            q = ((q * qX) * qY) * qZ;
-            transforms.scale = pxr::GfVec3f(
-              transforms.scale[0] * linkOp.scale[0],
-              transforms.scale[1] * linkOp.scale[1],
-              transforms.scale[2] * linkOp.scale[2]);
+            continue;
           }
-        }
-        currentPrimName = currentPrim.GetName().GetString();
-        substrIndex = currentPrimName.size() - std::string("_link").size();
-        if (substrIndex >= 0 && substrIndex < currentPrimName.size())
-        {
-          if (currentPrimName.substr(substrIndex).find("_link") !=
-              std::string::npos)
+          currentPrim = stage->GetPrimAtPath(modelPath);
+          if (!currentPrim)
           {
-            currentPrim = currentPrim.GetParent();
-            auto modelXform = pxr::UsdGeomXformable(currentPrim);
-            auto modelOp = GetOp(modelXform);
-            transforms.position += modelOp.position;
-            ignition::math::Quaterniond qX, qY, qZ;
-            ignition::math::Angle angleX(IGN_DTOR(modelOp.rotXYZ[0]));
-            ignition::math::Angle angleY(IGN_DTOR(modelOp.rotXYZ[1]));
-            ignition::math::Angle angleZ(IGN_DTOR(modelOp.rotXYZ[2]));
-            qX = ignition::math::Quaterniond(angleX.Normalized().Radian(), 0, 0);
-            qY = ignition::math::Quaterniond(0, angleY.Normalized().Radian(), 0);
-            qZ = ignition::math::Quaterniond(0, 0, angleZ.Normalized().Radian());
-            q = ((q * qX) * qY) * qZ;
-            transforms.scale = pxr::GfVec3f(
-              transforms.scale[0] * modelOp.scale[0],
-              transforms.scale[1] * modelOp.scale[1],
-              transforms.scale[2] * modelOp.scale[2]);
+            continue;
           }
         }
 
-        std::size_t found = std::string(currentPrim.GetName()).find("_link");
-        if (found != std::string::npos)
-          continue;
-        found = std::string(currentPrim.GetName()).find("_visual");
-        if (found != std::string::npos)
-          continue;
+        // World transform of the model, the changed prim may be one of its
+        // links or visuals. The ancestors are shared by all the prims of the
+        // notice.
+        const auto transform =
+            xformCache.GetLocalToWorldTransform(currentPrim)
+                .RemoveScaleShear();
+        const pxr::GfVec3d position = transform.ExtractTranslation();
+        const pxr::GfQuatd rotation =
+            transform.ExtractRotationQuat().GetNormalized();
 
         auto poseMsg = req.add_pose();
         poseMsg->set_name(currentPrim.GetName());
 
-        poseMsg->mutable_position()->set_x(transforms.position[0]);
-        poseMsg->mutable_position()->set_y(transforms.position[1]);
-        poseMsg->mutable_position()->set_z(transforms.position[2]);
+        poseMsg->mutable_position()->set_x(position[0]);
+        poseMsg->mutable_position()->set_y(position[1]);
+        poseMsg->mutable_position()->set_z(position[2]);
 
-        poseMsg->mutable_orientation()->set_x(q.X());
-        poseMsg->mutable_orientation()->set_y(q.Y());
-        poseMsg->mutable_orientation()->set_z(q.Z());
-        poseMsg->mutable_orientation()->set_w(q.W());
+        poseMsg->mutable_orientation()->set_x(rotation.GetImaginary()[0]);
+        poseMsg->mutable_orientation()->set_y(rotation.GetImaginary()[1]);
+        poseMsg->mutable_orientation()->set_z(rotation.GetImaginary()[2]);
+        poseMsg->mutable_orientation()->set_w(rotation.GetReal());
+      }
+    }
+    // don't wait for Ignition while holding the stage lock
+    if (this->poseSender)
+    {
+      this->poseSender->Submit(req);
+    }
+  }
+}
+void FUSDNoticeListener::Implementation::ProcessLoop()
+{
+  auto nextBatch = std::chrono::steady_clock::now();
+  while (true)
+  {
+    std::set<pxr::SdfPath> resyncedPaths;
+    std::set<pxr::SdfPath> changedInfoOnlyPaths;
+    std::set<pxr::SdfPath> suppressedResyncedPaths;
+    bool newNotices = false;
+    {
+      std::unique_lock<std::mutex> lock(this->captureMutex);
+      nextBatch += this->batchPeriod;
+      if (this->captureCv.wait_until(
+            lock, nextBatch, [this] { return this->stop; }))
+      {
+        return;
       }
+      // don't try to catch up after a slow batch
+      nextBatch = std::max(nextBatch, std::chrono::steady_clock::now());
+      newNotices = this->noticesReceived != this->noticesProcessed;
+      if (!newNotices && this->suppressedResyncedPaths.empty())
+      {
+        continue;
+      }
+      this->noticesProcessed = this->noticesReceived;
+      resyncedPaths.swap(this->resyncedPaths);
+      changedInfoOnlyPaths.swap(this->changedInfoOnlyPaths);
+      suppressedResyncedPaths.swap(this->suppressedResyncedPaths);
+    }
+
+    if (!suppressedResyncedPaths.empty())
+    {
+      auto stage = this->stage->Lock();
+      this->UpdateJointRegistry(*stage, suppressedResyncedPaths);
     }
-    if (req.pose_size() > 0)
+    if (!newNotices)
     {
-      bool result;
-      ignition::msgs::Boolean rep;
-      unsigned int timeout = 100;
-      bool executed = this->dataPtr->node.Request(
-        "/world/" + this->dataPtr->worldName + "/set_pose_vector",
-        req, timeout, rep, result);
-      if (executed)
+      continue;
+    }
+
+    this->ProcessBatch(resyncedPaths, changedInfoOnlyPaths);
+
+    std::lock_guard<std::mutex> lock(this->captureMutex);
+    ++this->batchesProcessed;
+    this->pathsProcessed += resyncedPaths.size() + changedInfoOnlyPaths.size();
+  }
+}
+
+FUSDNoticeListener::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->captureMutex);
+    this->stop = true;
+  }
+  this->captureCv.notify_all();
+  if (this->processThread.joinable())
+  {
+    this->processThread.join();
+  }
+}
+
+void FUSDNoticeListener::Handle(
+  const class pxr::UsdNotice::ObjectsChanged &ObjectsChanged)
+{
+  // Only capture the paths, they are processed in batches by
+  // `ProcessLoop`.
+  std::lock_guard<std::mutex> lock(this->dataPtr->captureMutex);
+  // changes made by the bridge come from Ignition already
+  if (AuthoringGuard::Active())
+  {
+    ++this->dataPtr->noticesSuppressed;
+    // the joints created by the bridge are commanded like the others
+    if (this->dataPtr->simulatorPoses == Simulator::IsaacSim)
+    {
+      for (const pxr::SdfPath &path : ObjectsChanged.GetResyncedPaths())
       {
-        if (!result)
-          ignerr << "Service call failed" << std::endl;
+        this->dataPtr->suppressedResyncedPaths.insert(path);
       }
-      else
-        ignerr << "Service [/world/" << this->dataPtr->worldName
-               << "/set_pose_vector] call timed out" << std::endl;
     }
+    return;
   }
+  ++this->dataPtr->noticesReceived;
+  for (const pxr::SdfPath &path : ObjectsChanged.GetResyncedPaths())
+  {
+    this->dataPtr->resyncedPaths.insert(path);
+  }
+  for (const pxr::SdfPath &path : ObjectsChanged.GetChangedInfoOnlyPaths())
+  {
+    this->dataPtr->changedInfoOnlyPaths.insert(path);
+  }
+}
+
+FUSDNoticeListener::Stats FUSDNoticeListener::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->captureMutex);
+  Stats stats;
+  stats.noticesReceived = this->dataPtr->noticesReceived;
+  stats.noticesSuppressed = this->dataPtr->noticesSuppressed;
+  stats.batchesProcessed = this->dataPtr->batchesProcessed;
+  stats.pathsProcessed = this->dataPtr->pathsProcessed;
+  stats.pendingPaths = this->dataPtr->resyncedPaths.size() +
+                       this->dataPtr->changedInfoOnlyPaths.size();
+  return stats;
 }
 }  // namespace omniverse
 }  // namespace ignition
@@ -17,9 +17,14 @@
 #ifndef IGNITION_OMNIVERSE_FUSDNOTICELISTENER_HPP
 #define IGNITION_OMNIVERSE_FUSDNOTICELISTENER_HPP
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
+#include "EntitySpawner.hpp"
+#include "MeshExporter.hpp"
+#include "PoseSender.hpp"
+#include "PrimRoles.hpp"
 #include "ThreadSafe.hpp"
 #include "Scene.hpp"
 
@@ -29,17 +34,47 @@ namespace ignition
 {
 namespace omniverse
 {
+/// \brief Sends the changes made by other clients of the stage to Ignition.
+/// \details `Handle` only captures the changed paths. They are processed
+/// in batches, at most `_batchRate` times per second, by a dedicated
+/// thread.
 class FUSDNoticeListener : public pxr::TfWeakBase
 {
  public:
+  struct Stats
+  {
+    std::size_t noticesReceived = 0;
+    /// \brief Notices of the changes made by the bridge, ignored
+    std::size_t noticesSuppressed = 0;
+    std::size_t batchesProcessed = 0;
+    /// \brief Unique paths processed over all the batches
+    std::size_t pathsProcessed = 0;
+    /// \brief Paths waiting for the next batch
+    std::size_t pendingPaths = 0;
+  };
+
   FUSDNoticeListener(
     std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> &_stage,
     const std::string &_worldName,
     Simulator _simulatorPoses,
-    std::unordered_map<std::string, uint32_t> &entitiesByName);
+    std::shared_ptr<const PrimRoles> _roles,
+    double _batchRate = 60,
+    JointCommands _jointCommands = JointCommands::PerJoint);
 
   void Handle(const class pxr::UsdNotice::ObjectsChanged &ObjectsChanged);
 
+  Stats GetStats() const;
+
+  /// \brief Sender of the poses to Ignition, null unless the poses come
+  /// from IsaacSim.
+  const PoseSender *Poses() const;
+
+  /// \brief Spawner of the models added by other clients of the stage
+  const EntitySpawner *Spawner() const;
+
+  /// \brief Exporter of the meshes of the models added by other clients
+  const MeshExporter *ExportedMeshes() const;
+
   /// \internal
   /// \brief Private data pointer
   IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
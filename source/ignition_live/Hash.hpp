@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_HASH_HPP
+#define IGNITION_OMNIVERSE_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Incremental 64 bits FNV-1a hash.
+/// \details Not cryptographic, but fast and stable across runs and
+/// platforms, so it can be used to name content.
+class Fnv1a
+{
+ public:
+  /// \brief Hash a block of bytes
+  Fnv1a &Update(const void *_data, std::size_t _size)
+  {
+    const auto *bytes = static_cast<const unsigned char *>(_data);
+    for (std::size_t i = 0; i < _size; ++i)
+    {
+      this->hash ^= bytes[i];
+      this->hash *= kPrime;
+    }
+    return *this;
+  }
+
+  /// \brief Hash the contents of a string
+  Fnv1a &Update(const std::string &_str)
+  {
+    return this->Update(_str.data(), _str.size());
+  }
+
+  /// \brief Hash the bytes of a trivially copyable value
+  template <typename T>
+  Fnv1a &UpdateValue(const T &_value)
+  {
+    return this->Update(&_value, sizeof(T));
+  }
+
+  std::uint64_t Digest() const { return this->hash; }
+
+  /// \brief Digest as 16 hexadecimal characters
+  std::string HexDigest() const
+  {
+    std::ostringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << this->hash;
+    return ss.str();
+  }
+
+ private:
+  static constexpr std::uint64_t kOffset = 0xcbf29ce484222325ull;
+  static constexpr std::uint64_t kPrime = 0x100000001b3ull;
+
+  std::uint64_t hash = kOffset;
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -17,20 +17,35 @@
 
 #include "Material.hpp"
 
+#include "Hash.hpp"
+
 #include <ignition/common/Console.hh>
 #include <ignition/math/Color.hh>
 
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/editTarget.h>
 #include <pxr/usd/usd/tokens.h>
 #include <pxr/usd/usdGeom/gprim.h>
 #include <pxr/usd/usdShade/material.h>
 #include <pxr/usd/usdShade/materialBindingAPI.h>
+#include <pxr/usd/usdShade/shader.h>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
-
-#include <OmniClient.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace ignition
 {
@@ -77,373 +92,752 @@ std::string checkURI(const std::string _fullPath)
   return fullPath;
 }
 
-/// \brief Copy a file in a directory
+/// \brief Hash of the contents of a local file. Hashes are cached by path,
+/// size and modification time, so a file is read only once.
+/// \param[in] _path path of the file
+/// \return The hash as an hexadecimal string, or an empty string if the file
+/// can't be read
+std::string fileContentHash(const std::string &_path)
+{
+  struct Entry
+  {
+    std::uintmax_t size;
+    std::filesystem::file_time_type modified;
+    std::string hash;
+  };
+  static std::mutex mutex;
+  static std::unordered_map<std::string, Entry> cache;
+
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(_path, ec);
+  if (ec)
+  {
+    return "";
+  }
+  const auto modified = std::filesystem::last_write_time(_path, ec);
+  if (ec)
+  {
+    return "";
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(_path);
+    if (it != cache.end() && it->second.size == size &&
+        it->second.modified == modified)
+    {
+      return it->second.hash;
+    }
+  }
+
+  std::ifstream file(_path, std::ios::binary);
+  if (!file)
+  {
+    return "";
+  }
+  Fnv1a hash;
+  std::vector<char> buffer(1 << 16);
+  while (file)
+  {
+    file.read(buffer.data(), buffer.size());
+    hash.Update(buffer.data(), static_cast<std::size_t>(file.gcount()));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &entry = cache[_path];
+  entry = {size, modified, hash.HexDigest()};
+  return entry.hash;
+}
+
+/// \brief Whether a texture goes through the processor before its upload
+/// \param[in] _fullPath full path of the texture
+/// \param[in] _processor texture processor, null if disabled
+bool isProcessedTexture(const std::string &_fullPath,
+                        const TextureProcessor *_processor)
+{
+  return _processor && _processor->Handles(_fullPath) &&
+         !fileContentHash(_fullPath).empty();
+}
+
+/// \brief Create the path to copy the material
+/// \details The name of the copy contains the hash of its contents, so
+/// identical textures are copied once, a texture already in the stage
+/// directory is not copied again, and textures of different models with the
+/// same file name don't overwrite each other.
+/// \param[in] _uri uri of the file to copy
+/// \param[in] _fullPath full path of the file to copy
+/// \param[in] _processor texture processor, null if disabled
+/// \return A relative path to save the material, the path looks like:
+/// materials/textures/<filename>_<hash>.<extension>, or
+/// materials/textures/<filename>_<hash>_<max resolution>.png for processed
+/// textures, or materials/textures/<filename with extension> if the file
+/// can't be read
+std::string getMaterialCopyPath(const std::string &_uri,
+                                const std::string &_fullPath,
+                                const TextureProcessor *_processor)
+{
+  std::string name = ignition::common::basename(_uri);
+  const std::string hash = fileContentHash(_fullPath);
+  if (!hash.empty())
+  {
+    const auto dot = name.rfind('.');
+    const std::string stem =
+        dot == std::string::npos ? name : name.substr(0, dot);
+    const std::string extension =
+        dot == std::string::npos ? "" : name.substr(dot);
+    if (isProcessedTexture(_fullPath, _processor))
+    {
+      name = stem + "_" + hash + "_" +
+             std::to_string(_processor->MaxResolution()) + ".png";
+    }
+    else
+    {
+      name = stem + "_" + hash + extension;
+    }
+  }
+  return ignition::common::joinPaths(".", "materials", "textures", name);
+}
+
+/// \brief Queue the copy of a file in the stage directory, the copy runs in
+/// the background so the material can be authored right away with its
+/// final asset path.
 /// \param[in] _path path where the copy will be located
 /// \param[in] _fullPath name of the file to copy
 /// \param[in] _stageDirUrl stage directory URL to copy materials if required
+/// \param[in] _textures uploader running the copy
+/// \param[in] _processor processes the texture before its upload, null if
+/// disabled
+/// \return true if the copy was queued
 bool copyMaterial(
   const std::string &_path,
   const std::string &_fullPath,
-  const std::string &_stageDirUrl)
+  const std::string &_stageDirUrl,
+  TextureUploader &_textures,
+  TextureProcessor *_processor)
 {
-  if (!_path.empty() && !_fullPath.empty())
-  {
-    ///
-    auto fileName = ignition::common::basename(_path);
-    auto filePathIndex = _path.rfind(fileName);
-    auto filePath = _path.substr(0, filePathIndex);
-    if (!omniClientWaitFor(omniClientCopy(
-      _fullPath.c_str(),
-      std::string(_stageDirUrl + "/" + _path).c_str(),
-      nullptr,
-      nullptr), 1000))
-    {
-      ignerr << "omniClientCopy timeout. Not able to copy file ["
-             << _fullPath.c_str() << "]" << "in nucleus ["
-             << std::string(_stageDirUrl + "/" + _path) << "]." ;
-    }
+  if (_path.empty() || _fullPath.empty())
+  {
+    return false;
   }
-  return false;
+  const std::string dst = _stageDirUrl + "/" + _path;
+  if (isProcessedTexture(_fullPath, _processor))
+  {
+    _processor->Submit(_fullPath, ignition::common::basename(_path),
+                       [&_textures, dst](const std::string &_processed)
+                       { _textures.Upload(_processed, dst); });
+  }
+  else
+  {
+    _textures.Upload(_fullPath, dst);
+  }
+  return true;
 }
 
-/// \brief Create the path to copy the material
-/// \param[in] _uri full path of the file to copy
-/// \return A relative path to save the material, the path looks like:
-/// materials/textures/<filename with extension>
-std::string getMaterialCopyPath(const std::string &_uri)
+/// \brief Inputs of the OmniPBR shader authored by the bridge, they index
+/// the table returned by `omniPBRInputs`.
+enum class OmniPBRInput
+{
+  DiffuseColor,
+  EmissiveColor,
+  EnableEmission,
+  EmissiveIntensity,
+  Metallic,
+  Roughness,
+  DiffuseTexture,
+  MetallicTexture,
+  NormalTexture,
+  RoughnessTexture,
+  RoughnessTextureInfluence,
+  Count
+};
+
+/// \brief Description of a shader input, with the metadata shown by the
+/// material editors.
+struct ShaderInputSchema
+{
+  /// \brief Name of the input, without the "inputs:" namespace
+  pxr::TfToken name;
+  /// \brief Name of the attribute of the input
+  pxr::TfToken attrName;
+  pxr::SdfValueTypeName type;
+  std::map<pxr::TfToken, pxr::VtValue> customData;
+  pxr::TfToken displayName;
+  pxr::TfToken displayGroup;
+  std::string doc;
+  /// \brief Color space of the textures
+  pxr::TfToken colorSpace;
+};
+
+/// \brief Table of the OmniPBR inputs, indexed by `OmniPBRInput`. It is
+/// built once, so tokens and custom data aren't created for every material.
+const std::vector<ShaderInputSchema> &omniPBRInputs()
 {
-return ignition::common::joinPaths(
-  ".",
-  "materials",
-  "textures",
-  ignition::common::basename(_uri));
+  static const std::vector<ShaderInputSchema> inputs = []()
+  {
+    auto input = [](const std::string &_name,
+                    const pxr::SdfValueTypeName &_type,
+                    std::map<pxr::TfToken, pxr::VtValue> _customData,
+                    const std::string &_displayName,
+                    const std::string &_displayGroup,
+                    const std::string &_doc = "",
+                    const std::string &_colorSpace = "")
+    {
+      return ShaderInputSchema{pxr::TfToken(_name),
+                               pxr::TfToken("inputs:" + _name),
+                               _type,
+                               std::move(_customData),
+                               pxr::TfToken(_displayName),
+                               pxr::TfToken(_displayGroup),
+                               _doc,
+                               pxr::TfToken(_colorSpace)};
+    };
+    const pxr::TfToken defaultKey("default");
+    const pxr::TfToken maxKey("range:max");
+    const pxr::TfToken minKey("range:min");
+    const pxr::VtValue colorMax(pxr::GfVec3f(100000, 100000, 100000));
+    const pxr::VtValue colorMin(pxr::GfVec3f(0, 0, 0));
+    const pxr::VtValue noTexture{pxr::SdfAssetPath()};
+
+    std::vector<ShaderInputSchema> table(
+      static_cast<std::size_t>(OmniPBRInput::Count));
+    auto at = [&table](OmniPBRInput _input) -> ShaderInputSchema &
+    {
+      return table[static_cast<std::size_t>(_input)];
+    };
+    at(OmniPBRInput::DiffuseColor) = input(
+      "diffuse_color_constant", pxr::SdfValueTypeNames->Color3f,
+      {{defaultKey, pxr::VtValue(pxr::GfVec3f(0.2, 0.2, 0.2))},
+       {maxKey, colorMax},
+       {minKey, colorMin}},
+      "Base Color", "Albedo", "This is the base color");
+    at(OmniPBRInput::EmissiveColor) = input(
+      "emissive_color", pxr::SdfValueTypeNames->Color3f,
+      {{defaultKey, pxr::VtValue(pxr::GfVec3f(1, 0.1, 0.1))},
+       {maxKey, colorMax},
+       {minKey, colorMin}},
+      "Emissive Color", "Emissive", "The emission color");
+    at(OmniPBRInput::EnableEmission) = input(
+      "enable_emission", pxr::SdfValueTypeNames->Bool,
+      {{defaultKey, pxr::VtValue(0)}},
+      "Enable Emissive", "Emissive",
+      "Enables the emission of light from the material");
+    at(OmniPBRInput::EmissiveIntensity) = input(
+      "emissive_intensity", pxr::SdfValueTypeNames->Float,
+      {{defaultKey, pxr::VtValue(40)},
+       {maxKey, pxr::VtValue(100000)},
+       {minKey, pxr::VtValue(0)}},
+      "Emissive Intensity", "Emissive", "Intensity of the emission");
+    at(OmniPBRInput::Metallic) = input(
+      "metallic_constant", pxr::SdfValueTypeNames->Float,
+      {{defaultKey, pxr::VtValue(0.5)},
+       {maxKey, pxr::VtValue(1)},
+       {minKey, pxr::VtValue(0)}},
+      "Metallic Amount", "Reflectivity", "Metallic Material");
+    at(OmniPBRInput::Roughness) = input(
+      "reflection_roughness_constant", pxr::SdfValueTypeNames->Float,
+      {{defaultKey, pxr::VtValue(0.5)},
+       {maxKey, pxr::VtValue(1)},
+       {minKey, pxr::VtValue(0)}},
+      "Roughness Amount", "Reflectivity",
+      "Higher roughness values lead to more blurry reflections");
+    at(OmniPBRInput::DiffuseTexture) = input(
+      "diffuse_texture", pxr::SdfValueTypeNames->Asset,
+      {{defaultKey, noTexture}}, "Base Map", "Albedo", "", "auto");
+    at(OmniPBRInput::MetallicTexture) = input(
+      "metallic_texture", pxr::SdfValueTypeNames->Asset,
+      {{defaultKey, noTexture}}, "Metallic Map", "Reflectivity", "", "raw");
+    at(OmniPBRInput::NormalTexture) = input(
+      "normalmap_texture", pxr::SdfValueTypeNames->Asset,
+      {{defaultKey, noTexture}}, "Normal Map", "Normal", "", "raw");
+    at(OmniPBRInput::RoughnessTexture) = input(
+      "reflectionroughness_texture", pxr::SdfValueTypeNames->Asset,
+      {{defaultKey, noTexture}}, "RoughnessMap Map", "RoughnessMap", "",
+      "raw");
+    at(OmniPBRInput::RoughnessTextureInfluence) = input(
+      "reflection_roughness_texture_influence", pxr::SdfValueTypeNames->Bool,
+      {{defaultKey, pxr::VtValue(0)},
+       {maxKey, pxr::VtValue(1)},
+       {minKey, pxr::VtValue(0)}},
+      "Roughness Map Influence", "Reflectivity", "", "raw");
+    return table;
+  }();
+  return inputs;
 }
 
-/// \brief Fill Material shader attributes and properties
-/// \param[in] _prim USD primitive
-/// \param[in] _name Name of the field attribute or property
-/// \param[in] _vType Type of the field
-/// \param[in] _value Value of the field
-/// \param[in] _customData Custom data to set the field
-/// \param[in] _displayName Display name
-/// \param[in] _displayGroup Display group
-/// \param[in] _doc Documentation of the field
-/// \param[in] _colorSpace if the material is a texture, we can specify the
-/// colorSpace of the image
-template <typename T>
-void CreateMaterialInput(
-    const pxr::UsdPrim &_prim, const std::string &_name,
-    const pxr::SdfValueTypeName &_vType, T _value,
-    const std::map<pxr::TfToken, pxr::VtValue> &_customData,
-    const pxr::TfToken &_displayName = pxr::TfToken(""),
-    const pxr::TfToken &_displayGroup = pxr::TfToken(""),
-    const std::string &_doc = "",
-    const pxr::TfToken &_colorSpace = pxr::TfToken(""))
+/// \brief Get the material whose shader all the shaders specialize,
+/// creating it if needed.
+/// \details It is a class prim holding the OmniPBR shader and the metadata
+/// of every input, so the materials only need to author the values of their
+/// inputs. Class prims must be root prims, and they are abstract so it is
+/// never rendered.
+/// \param[in] _stage stage of the materials
+/// \return The prototype material
+pxr::UsdShadeMaterial omniPBRPrototype(const pxr::UsdStageRefPtr &_stage)
 {
-  auto shader = pxr::UsdShadeShader(_prim);
-  if (shader)
+  const pxr::SdfPath path("/_OmniPBR_Base");
+  pxr::UsdShadeMaterial prototype(_stage->GetPrimAtPath(path));
+  if (prototype)
+  {
+    return prototype;
+  }
+
+  auto prim = _stage->CreateClassPrim(path);
+  if (!prim)
   {
-    auto existingInput = shader.GetInput(pxr::TfToken(_name));
-    pxr::SdfValueTypeName vTypeName;
-    if (_vType.IsScalar())
+    ignerr << "Failed to create the OmniPBR prototype [" << path << "]"
+           << std::endl;
+    return prototype;
+  }
+  prim.SetTypeName(pxr::TfToken("Material"));
+  prototype = pxr::UsdShadeMaterial(prim);
+  auto usdShader = pxr::UsdShadeShader::Define(
+    _stage, path.AppendChild(pxr::TfToken("Shader")));
+  auto shaderPrim = usdShader.GetPrim();
+
+  auto shaderOut =
+      pxr::UsdShadeConnectableAPI(shaderPrim)
+          .CreateOutput(pxr::TfToken("out"), pxr::SdfValueTypeNames->Token);
+  prototype.CreateSurfaceOutput(pxr::TfToken("mdl"))
+      .ConnectToSource(shaderOut);
+  prototype.CreateVolumeOutput(pxr::TfToken("mdl")).ConnectToSource(shaderOut);
+  prototype.CreateDisplacementOutput(pxr::TfToken("mdl"))
+      .ConnectToSource(shaderOut);
+  usdShader.GetImplementationSourceAttr().Set(pxr::UsdShadeTokens->sourceAsset);
+  usdShader.SetSourceAsset(pxr::SdfAssetPath("OmniPBR.mdl"),
+                           pxr::TfToken("mdl"));
+  usdShader.SetSourceAssetSubIdentifier(pxr::TfToken("OmniPBR"),
+                                        pxr::TfToken("mdl"));
+
+  for (const auto &input : omniPBRInputs())
+  {
+    auto attr = usdShader.CreateInput(input.name, input.type).GetAttr();
+    for (const auto &[key, customValue] : input.customData)
     {
-      vTypeName = _vType.GetScalarType();
+      attr.SetCustomDataByKey(key, customValue);
     }
-    else if (_vType.IsArray())
+    if (!input.displayName.IsEmpty())
     {
-      vTypeName = _vType.GetArrayType();
+      attr.SetDisplayName(input.displayName);
     }
-    auto surfaceInput = shader.CreateInput(pxr::TfToken(_name), vTypeName);
-    surfaceInput.Set(_value);
-    auto attr = surfaceInput.GetAttr();
-
-    for (const auto &[key, customValue] : _customData)
+    if (!input.displayGroup.IsEmpty())
     {
-      attr.SetCustomDataByKey(key, customValue);
+      attr.SetDisplayGroup(input.displayGroup);
     }
-    if (!_displayName.GetString().empty())
+    if (!input.doc.empty())
     {
-      attr.SetDisplayName(_displayName);
+      attr.SetDocumentation(input.doc);
     }
-    if (!_displayGroup.GetString().empty())
+    if (!input.colorSpace.IsEmpty())
     {
-      attr.SetDisplayGroup(_displayGroup);
+      attr.SetColorSpace(input.colorSpace);
     }
-    if (!_doc.empty())
+  }
+  return prototype;
+}
+
+/// \brief Define a material whose shader specializes the shader of the
+/// prototype.
+/// \param[in] _stage stage of the material
+/// \param[in] _path path of the material
+/// \return The material, invalid if the prototype can't be created
+pxr::UsdShadeMaterial defineOmniPBRMaterial(const pxr::UsdStageRefPtr &_stage,
+                                            const pxr::SdfPath &_path)
+{
+  const auto prototype = omniPBRPrototype(_stage);
+  if (!prototype)
+  {
+    return pxr::UsdShadeMaterial();
+  }
+  const pxr::TfToken shaderName("Shader");
+  auto material = pxr::UsdShadeMaterial::Define(_stage, _path);
+  auto usdShader =
+      pxr::UsdShadeShader::Define(_stage, _path.AppendChild(shaderName));
+  usdShader.GetPrim().GetSpecializes().AddSpecialize(
+    prototype.GetPath().AppendChild(shaderName));
+
+  auto shaderOut =
+      pxr::UsdShadeConnectableAPI(usdShader.GetPrim())
+          .CreateOutput(pxr::TfToken("out"), pxr::SdfValueTypeNames->Token);
+  material.CreateSurfaceOutput(pxr::TfToken("mdl")).ConnectToSource(shaderOut);
+  material.CreateVolumeOutput(pxr::TfToken("mdl")).ConnectToSource(shaderOut);
+  material.CreateDisplacementOutput(pxr::TfToken("mdl"))
+      .ConnectToSource(shaderOut);
+  return material;
+}
+
+/// \brief Values of the inputs of a shader
+using ShaderInputValues = std::vector<std::pair<OmniPBRInput, pxr::VtValue>>;
+
+/// \brief Author the values of the inputs of a shader in a single change
+/// block, using the Sdf API on the edit target.
+/// \param[in] _stage stage of the shader
+/// \param[in] _shaderPath path of the shader
+/// \param[in] _values values of the inputs
+void authorShaderInputs(const pxr::UsdStageRefPtr &_stage,
+                        const pxr::SdfPath &_shaderPath,
+                        const ShaderInputValues &_values)
+{
+  const auto &inputs = omniPBRInputs();
+  const auto editTarget = _stage->GetEditTarget();
+  const auto layer = editTarget.GetLayer();
+
+  pxr::SdfChangeBlock changeBlock;
+  auto shaderSpec =
+      pxr::SdfCreatePrimInLayer(layer, editTarget.MapToSpecPath(_shaderPath));
+  for (const auto &[id, value] : _values)
+  {
+    const auto &input = inputs[static_cast<std::size_t>(id)];
+    auto attrSpec = layer->GetAttributeAtPath(
+      shaderSpec->GetPath().AppendProperty(input.attrName));
+    if (!attrSpec)
+    {
+      attrSpec = pxr::SdfAttributeSpec::New(
+        shaderSpec, input.attrName.GetString(), input.type);
+    }
+    attrSpec->SetDefaultValue(value);
+  }
+}
+
+/// \brief Values of the inputs that don't depend on textures
+/// \param[in] _materialMsg material message
+ShaderInputValues constantInputValues(
+  const ignition::msgs::Material &_materialMsg)
+{
+  ShaderInputValues values;
+  values.reserve(static_cast<std::size_t>(OmniPBRInput::Count));
+
+  ignition::math::Color diffuse(
+      _materialMsg.diffuse().r(), _materialMsg.diffuse().g(),
+      _materialMsg.diffuse().b(), _materialMsg.diffuse().a());
+  values.emplace_back(
+    OmniPBRInput::DiffuseColor,
+    pxr::VtValue(pxr::GfVec3f(diffuse.R(), diffuse.G(), diffuse.B())));
+
+  ignition::math::Color emissive(_materialMsg.emissive().r(),
+                                 _materialMsg.emissive().g(),
+                                 _materialMsg.emissive().b(),
+                                 _materialMsg.emissive().a());
+  values.emplace_back(
+    OmniPBRInput::EmissiveColor,
+    pxr::VtValue(pxr::GfVec3f(emissive.R(), emissive.G(), emissive.B())));
+  values.emplace_back(OmniPBRInput::EnableEmission,
+                      pxr::VtValue(emissive.A() > 0));
+  values.emplace_back(OmniPBRInput::EmissiveIntensity,
+                      pxr::VtValue(static_cast<float>(emissive.A())));
+
+  if (_materialMsg.has_pbr())
+  {
+    const auto &pbr = _materialMsg.pbr();
+    values.emplace_back(OmniPBRInput::Metallic,
+                        pxr::VtValue(static_cast<float>(pbr.metalness())));
+    values.emplace_back(OmniPBRInput::Roughness,
+                        pxr::VtValue(static_cast<float>(pbr.roughness())));
+  }
+  return values;
+}
+
+/// \brief Texture of a material
+struct TextureFile
+{
+  OmniPBRInput input;
+  std::string uri;
+  /// \brief Path of the file, the uri if it can't be found
+  std::string fullPath;
+};
+
+/// \brief Find the files of the textures of a material
+/// \param[in] _materialMsg material message
+std::vector<TextureFile> textureFiles(
+  const ignition::msgs::Material &_materialMsg)
+{
+  std::vector<TextureFile> files;
+  if (!_materialMsg.has_pbr())
+  {
+    return files;
+  }
+  const auto &pbr = _materialMsg.pbr();
+
+  auto add = [&files](OmniPBRInput _input, const std::string &_uri,
+                      const std::string &_fullPath)
+  {
+    files.push_back({_input, _uri, _fullPath.empty() ? _uri : _fullPath});
+  };
+  if (!pbr.albedo_map().empty())
+  {
+    std::string albedoMapURI = checkURI(pbr.albedo_map());
+    add(OmniPBRInput::DiffuseTexture, pbr.albedo_map(),
+        ignition::common::findFile(
+          ignition::common::basename(albedoMapURI)));
+  }
+  if (!pbr.metalness_map().empty())
+  {
+    add(OmniPBRInput::MetallicTexture, pbr.metalness_map(),
+        ignition::common::findFile(
+          ignition::common::basename(pbr.metalness_map())));
+  }
+  if (!pbr.normal_map().empty())
+  {
+    add(OmniPBRInput::NormalTexture, pbr.normal_map(),
+        ignition::common::findFile(
+          ignition::common::basename(pbr.normal_map())));
+  }
+  if (!pbr.roughness_map().empty())
+  {
+    add(OmniPBRInput::RoughnessTexture, pbr.roughness_map(),
+        ignition::common::findFile(
+          ignition::common::basename(pbr.roughness_map())));
+  }
+  return files;
+}
+
+/// \brief Values of the texture inputs. The textures are copied next to the
+/// stage.
+/// \param[in] _materialMsg material message
+/// \param[in] _stageDirUrl url of the directory of the stage
+/// \param[in] _textures uploader of the textures
+/// \param[in] _processor processor of the textures, or null
+ShaderInputValues textureInputValues(
+  const ignition::msgs::Material &_materialMsg,
+  const std::string &_stageDirUrl, TextureUploader &_textures,
+  TextureProcessor *_processor)
+{
+  ShaderInputValues values;
+  for (const auto &file : textureFiles(_materialMsg))
+  {
+    std::string copyPath =
+        getMaterialCopyPath(file.uri, file.fullPath, _processor);
+    copyMaterial(copyPath, file.fullPath, _stageDirUrl, _textures,
+                 _processor);
+    values.emplace_back(file.input,
+                        pxr::VtValue(pxr::SdfAssetPath(copyPath)));
+    if (file.input == OmniPBRInput::RoughnessTexture)
     {
-      attr.SetDocumentation(_doc);
+      values.emplace_back(OmniPBRInput::RoughnessTextureInfluence,
+                          pxr::VtValue(true));
     }
-    if (!_colorSpace.GetString().empty())
+  }
+  return values;
+}
+
+/// \brief Hash of the parameters of a material that end up in its shader,
+/// visuals with the same hash can share the same USD material.
+/// \param[in] _materialMsg material message
+/// \return The hash as an hexadecimal string
+std::string materialHash(const ignition::msgs::Material &_materialMsg)
+{
+  Fnv1a hash;
+  const auto &diffuse = _materialMsg.diffuse();
+  hash.UpdateValue(diffuse.r()).UpdateValue(diffuse.g())
+      .UpdateValue(diffuse.b());
+  const auto &emissive = _materialMsg.emissive();
+  hash.UpdateValue(emissive.r()).UpdateValue(emissive.g())
+      .UpdateValue(emissive.b()).UpdateValue(emissive.a());
+  hash.UpdateValue(_materialMsg.has_pbr());
+  if (_materialMsg.has_pbr())
+  {
+    const auto &pbr = _materialMsg.pbr();
+    hash.UpdateValue(pbr.metalness()).UpdateValue(pbr.roughness());
+    // the strings are separated by their size so that ("ab", "") and
+    // ("a", "b") differ
+    for (const auto &map : {pbr.albedo_map(), pbr.metalness_map(),
+                            pbr.normal_map(), pbr.roughness_map()})
     {
-      attr.SetColorSpace(_colorSpace);
+      hash.UpdateValue(map.size()).Update(map);
     }
   }
-  else
+  return hash.HexDigest();
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> ResolveTextures(
+  const ignition::msgs::Material &_materialMsg)
+{
+  std::vector<std::string> paths;
+  for (auto &file : textureFiles(_materialMsg))
   {
-    ignerr << "Not able to convert the prim to a UsdShadeShader" << std::endl;
+    paths.push_back(std::move(file.fullPath));
+  }
+  return paths;
+}
+
+//////////////////////////////////////////////////
+void HashTextures(const std::vector<std::string> &_paths)
+{
+  for (const auto &path : _paths)
+  {
+    fileContentHash(path);
   }
 }
 
 /// \param[in] _stageDirUrl stage directory URL to copy materials if required
+/// \param[in] _textures uploader copying the textures to the stage directory
+/// \param[in] _processor processes the textures before their upload, null
+/// if disabled
 bool SetMaterial(const pxr::UsdGeomGprim &_gprim,
                  const ignition::msgs::Visual &_visualMsg,
                  const pxr::UsdStageRefPtr &_stage,
-                 const std::string &_stageDirUrl)
+                 const std::string &_stageDirUrl,
+                 TextureUploader &_textures,
+                 TextureProcessor *_processor)
 {
   if (!_visualMsg.has_material())
   {
     return true;
   }
 
-  const std::string mtlPath = "/Looks/Material_" + _visualMsg.name() + "_" +
-                              std::to_string(_visualMsg.id());
-  pxr::UsdShadeMaterial material =
-      pxr::UsdShadeMaterial::Define(_stage, pxr::SdfPath(mtlPath));
-  auto usdShader =
-      pxr::UsdShadeShader::Define(_stage, pxr::SdfPath(mtlPath + "/Shader"));
-  auto shaderPrim = usdShader.GetPrim();
+  // Materials are named after the hash of their parameters, visuals with
+  // identical materials are bound to the same one and the shader network
+  // is authored only once.
+  const std::string mtlPath =
+      "/Looks/Material_" + materialHash(_visualMsg.material());
+  pxr::UsdShadeMaterial material(_stage->GetPrimAtPath(pxr::SdfPath(mtlPath)));
+  if (material)
+  {
+    pxr::UsdShadeMaterialBindingAPI(_gprim).Bind(material);
+    return true;
+  }
 
-  auto shaderOut =
-      pxr::UsdShadeConnectableAPI(shaderPrim)
-          .CreateOutput(pxr::TfToken("out"), pxr::SdfValueTypeNames->Token);
-  material.CreateSurfaceOutput(pxr::TfToken("mdl")).ConnectToSource(shaderOut);
-  material.CreateVolumeOutput(pxr::TfToken("mdl")).ConnectToSource(shaderOut);
-  material.CreateDisplacementOutput(pxr::TfToken("mdl"))
-      .ConnectToSource(shaderOut);
-  usdShader.GetImplementationSourceAttr().Set(pxr::UsdShadeTokens->sourceAsset);
-  usdShader.SetSourceAsset(pxr::SdfAssetPath("OmniPBR.mdl"),
-                           pxr::TfToken("mdl"));
-  usdShader.SetSourceAssetSubIdentifier(pxr::TfToken("OmniPBR"),
-                                        pxr::TfToken("mdl"));
+  // The shader and the metadata of the inputs are inherited from the
+  // prototype, only the values of the inputs are authored here.
+  material = defineOmniPBRMaterial(_stage, pxr::SdfPath(mtlPath));
+  if (!material)
+  {
+    return false;
+  }
 
-  std::map<pxr::TfToken, pxr::VtValue> customDataDiffuse = {
-      {pxr::TfToken("default"), pxr::VtValue(pxr::GfVec3f(0.2, 0.2, 0.2))},
-      {pxr::TfToken("range:max"),
-       pxr::VtValue(pxr::GfVec3f(100000, 100000, 100000))},
-      {pxr::TfToken("range:min"), pxr::VtValue(pxr::GfVec3f(0, 0, 0))}};
-  ignition::math::Color diffuse(
-      _visualMsg.material().diffuse().r(), _visualMsg.material().diffuse().g(),
-      _visualMsg.material().diffuse().b(), _visualMsg.material().diffuse().a());
-  CreateMaterialInput<pxr::GfVec3f>(
-      shaderPrim, "diffuse_color_constant", pxr::SdfValueTypeNames->Color3f,
-      pxr::GfVec3f(diffuse.R(), diffuse.G(), diffuse.B()), customDataDiffuse,
-      pxr::TfToken("Base Color"), pxr::TfToken("Albedo"),
-      "This is the base color");
-
-  std::map<pxr::TfToken, pxr::VtValue> customDataEmissive = {
-      {pxr::TfToken("default"), pxr::VtValue(pxr::GfVec3f(1, 0.1, 0.1))},
-      {pxr::TfToken("range:max"),
-       pxr::VtValue(pxr::GfVec3f(100000, 100000, 100000))},
-      {pxr::TfToken("range:min"), pxr::VtValue(pxr::GfVec3f(0, 0, 0))}};
-  ignition::math::Color emissive(_visualMsg.material().emissive().r(),
-                                 _visualMsg.material().emissive().g(),
-                                 _visualMsg.material().emissive().b(),
-                                 _visualMsg.material().emissive().a());
-  CreateMaterialInput<pxr::GfVec3f>(
-      shaderPrim, "emissive_color", pxr::SdfValueTypeNames->Color3f,
-      pxr::GfVec3f(emissive.R(), emissive.G(), emissive.B()),
-      customDataEmissive, pxr::TfToken("Emissive Color"),
-      pxr::TfToken("Emissive"), "The emission color");
-
-  std::map<pxr::TfToken, pxr::VtValue> customDataEnableEmission = {
-      {pxr::TfToken("default"), pxr::VtValue(0)}};
-
-  CreateMaterialInput<bool>(
-      shaderPrim, "enable_emission", pxr::SdfValueTypeNames->Bool,
-      emissive.A() > 0, customDataEnableEmission,
-      pxr::TfToken("Enable Emissive"), pxr::TfToken("Emissive"),
-      "Enables the emission of light from the material");
+  auto values = constantInputValues(_visualMsg.material());
+  auto textureValues = textureInputValues(_visualMsg.material(), _stageDirUrl,
+                                          _textures, _processor);
+  values.insert(values.end(), textureValues.begin(), textureValues.end());
+
+  authorShaderInputs(_stage, pxr::SdfPath(mtlPath + "/Shader"), values);
 
-  std::map<pxr::TfToken, pxr::VtValue> customDataIntensity = {
-      {pxr::TfToken("default"), pxr::VtValue(40)},
-      {pxr::TfToken("range:max"), pxr::VtValue(100000)},
-      {pxr::TfToken("range:min"), pxr::VtValue(0)}};
-  CreateMaterialInput<float>(
-      shaderPrim, "emissive_intensity", pxr::SdfValueTypeNames->Float,
-      emissive.A(), customDataIntensity, pxr::TfToken("Emissive Intensity"),
-      pxr::TfToken("Emissive"), "Intensity of the emission");
+  pxr::UsdShadeMaterialBindingAPI(_gprim).Bind(material);
+
+  return true;
+}
 
-  if (_visualMsg.material().has_pbr())
+//////////////////////////////////////////////////
+class MaterialUpdater::Implementation
+{
+ public:
+  static constexpr std::size_t kInputCount =
+      static_cast<std::size_t>(OmniPBRInput::Count);
+
+  pxr::SdfPath path;
+  pxr::UsdShadeMaterial material;
+  pxr::UsdPrim shaderPrim;
+  std::string stageDirUrl;
+  TextureUploader *textures = nullptr;
+  TextureProcessor *processor = nullptr;
+
+  /// \brief Attributes of the inputs, resolved on their first write
+  std::array<pxr::UsdAttribute, kInputCount> attributes;
+
+  /// \brief Last value written to each input, empty if not authored
+  std::array<pxr::VtValue, kInputCount> values;
+
+  /// \brief Uris of the textures of the last update, the textures are
+  /// resolved and copied again only when they change
+  std::string textureUris;
+  ShaderInputValues textureValues;
+};
+
+//////////////////////////////////////////////////
+MaterialUpdater::MaterialUpdater(const pxr::UsdGeomGprim &_gprim,
+                                 const std::string &_materialPath,
+                                 const pxr::UsdStageRefPtr &_stage,
+                                 const std::string &_stageDirUrl,
+                                 TextureUploader &_textures,
+                                 TextureProcessor *_processor)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  const pxr::SdfPath path(_materialPath);
+  this->dataPtr->path = path;
+  this->dataPtr->material = defineOmniPBRMaterial(_stage, path);
+  this->dataPtr->stageDirUrl = _stageDirUrl;
+  this->dataPtr->textures = &_textures;
+  this->dataPtr->processor = _processor;
+  if (!this->dataPtr->material)
   {
-    auto pbr = _visualMsg.material().pbr();
-    std::map<pxr::TfToken, pxr::VtValue> customDataMetallicConstant =
-    {
-      {pxr::TfToken("default"), pxr::VtValue(0.5)},
-      {pxr::TfToken("range:max"), pxr::VtValue(1)},
-      {pxr::TfToken("range:min"), pxr::VtValue(0)}
-    };
-    CreateMaterialInput<float>(
-      shaderPrim,
-      "metallic_constant",
-      pxr::SdfValueTypeNames->Float,
-      pbr.metalness(),
-      customDataMetallicConstant,
-      pxr::TfToken("Metallic Amount"),
-      pxr::TfToken("Reflectivity"),
-      "Metallic Material");
-    std::map<pxr::TfToken, pxr::VtValue> customDataRoughnessConstant =
-    {
-      {pxr::TfToken("default"), pxr::VtValue(0.5)},
-      {pxr::TfToken("range:max"), pxr::VtValue(1)},
-      {pxr::TfToken("range:min"), pxr::VtValue(0)}
-    };
-    CreateMaterialInput<float>(
-      shaderPrim,
-      "reflection_roughness_constant",
-      pxr::SdfValueTypeNames->Float,
-      pbr.roughness(),
-      customDataRoughnessConstant,
-      pxr::TfToken("Roughness Amount"),
-      pxr::TfToken("Reflectivity"),
-      "Higher roughness values lead to more blurry reflections");
-    if (!pbr.albedo_map().empty())
-    {
-      std::map<pxr::TfToken, pxr::VtValue> customDataDiffuseTexture =
-      {
-        {pxr::TfToken("default"), pxr::VtValue(pxr::SdfAssetPath())},
-      };
+    return;
+  }
+  this->dataPtr->shaderPrim =
+      _stage->GetPrimAtPath(path.AppendChild(pxr::TfToken("Shader")));
+  pxr::UsdShadeMaterialBindingAPI(_gprim).Bind(this->dataPtr->material);
+}
 
-      std::string copyPath = getMaterialCopyPath(pbr.albedo_map());
+//////////////////////////////////////////////////
+std::size_t MaterialUpdater::Update(
+  const ignition::msgs::Material &_materialMsg)
+{
+  if (!this->IsValid())
+  {
+    return 0;
+  }
 
-      std::string albedoMapURI = checkURI(pbr.albedo_map());
+  std::string textureUris;
+  if (_materialMsg.has_pbr())
+  {
+    const auto &pbr = _materialMsg.pbr();
+    textureUris = pbr.albedo_map() + '\n' + pbr.metalness_map() + '\n' +
+                  pbr.normal_map() + '\n' + pbr.roughness_map();
+  }
+  if (textureUris != this->dataPtr->textureUris)
+  {
+    this->dataPtr->textureValues = textureInputValues(
+      _materialMsg, this->dataPtr->stageDirUrl, *this->dataPtr->textures,
+      this->dataPtr->processor);
+    this->dataPtr->textureUris = textureUris;
+  }
 
-      std::string fullnameAlbedoMap =
-        ignition::common::findFile(
-          ignition::common::basename(albedoMapURI));
-
-      if (fullnameAlbedoMap.empty())
-      {
-        fullnameAlbedoMap = pbr.albedo_map();
-      }
-
-      copyMaterial(copyPath, fullnameAlbedoMap, _stageDirUrl);
-
-      CreateMaterialInput<pxr::SdfAssetPath>(
-        shaderPrim,
-        "diffuse_texture",
-        pxr::SdfValueTypeNames->Asset,
-        pxr::SdfAssetPath(copyPath),
-        customDataDiffuseTexture,
-        pxr::TfToken("Base Map"),
-        pxr::TfToken("Albedo"),
-        "",
-        pxr::TfToken("auto"));
+  std::array<pxr::VtValue, Implementation::kInputCount> next;
+  for (const auto &[id, value] : constantInputValues(_materialMsg))
+  {
+    next[static_cast<std::size_t>(id)] = value;
+  }
+  for (const auto &[id, value] : this->dataPtr->textureValues)
+  {
+    next[static_cast<std::size_t>(id)] = value;
+  }
+
+  const auto &inputs = omniPBRInputs();
+  std::size_t written = 0;
+  for (std::size_t i = 0; i < Implementation::kInputCount; ++i)
+  {
+    if (next[i] == this->dataPtr->values[i])
+    {
+      continue;
     }
-    if (!pbr.metalness_map().empty())
+    auto &attr = this->dataPtr->attributes[i];
+    if (!attr)
     {
-      std::map<pxr::TfToken, pxr::VtValue> customDataMetallnessTexture =
-      {
-        {pxr::TfToken("default"), pxr::VtValue(pxr::SdfAssetPath())},
-      };
-
-      std::string copyPath = getMaterialCopyPath(pbr.metalness_map());
-
-      std::string fullnameMetallnessMap =
-        ignition::common::findFile(
-          ignition::common::basename(pbr.metalness_map()));
-
-      if (fullnameMetallnessMap.empty())
-      {
-        fullnameMetallnessMap = pbr.metalness_map();
-      }
-
-      copyMaterial(copyPath, fullnameMetallnessMap, _stageDirUrl);
-
-      CreateMaterialInput<pxr::SdfAssetPath>(
-        shaderPrim,
-        "metallic_texture",
-        pxr::SdfValueTypeNames->Asset,
-        pxr::SdfAssetPath(copyPath),
-        customDataMetallnessTexture,
-        pxr::TfToken("Metallic Map"),
-        pxr::TfToken("Reflectivity"),
-        "",
-        pxr::TfToken("raw"));
+      attr = this->dataPtr->shaderPrim.GetAttribute(inputs[i].attrName);
     }
-    if (!pbr.normal_map().empty())
+    // Inputs missing from the message fall back to the prototype
+    if (next[i].IsEmpty())
     {
-      std::map<pxr::TfToken, pxr::VtValue> customDataNormalTexture =
-      {
-        {pxr::TfToken("default"), pxr::VtValue(pxr::SdfAssetPath())},
-      };
-
-      std::string copyPath = getMaterialCopyPath(pbr.normal_map());
-
-      std::string fullnameNormalMap =
-        ignition::common::findFile(
-          ignition::common::basename(pbr.normal_map()));
-
-      if (fullnameNormalMap.empty())
-      {
-        fullnameNormalMap = pbr.normal_map();
-      }
-
-      copyMaterial(copyPath, fullnameNormalMap, _stageDirUrl);
-
-      CreateMaterialInput<pxr::SdfAssetPath>(
-        shaderPrim,
-        "normalmap_texture",
-        pxr::SdfValueTypeNames->Asset,
-        pxr::SdfAssetPath(copyPath),
-        customDataNormalTexture,
-        pxr::TfToken("Normal Map"),
-        pxr::TfToken("Normal"),
-        "",
-        pxr::TfToken("raw"));
+      attr.Clear();
     }
-    if (!pbr.roughness_map().empty())
+    else
     {
-      std::map<pxr::TfToken, pxr::VtValue> customDataRoughnessTexture =
-      {
-        {pxr::TfToken("default"), pxr::VtValue(pxr::SdfAssetPath())},
-      };
-
-      std::string copyPath = getMaterialCopyPath(pbr.roughness_map());
-
-      std::string fullnameRoughnessMap =
-        ignition::common::findFile(
-          ignition::common::basename(pbr.roughness_map()));
-
-      if (fullnameRoughnessMap.empty())
-      {
-        fullnameRoughnessMap = pbr.roughness_map();
-      }
-
-      copyMaterial(copyPath, fullnameRoughnessMap, _stageDirUrl);
-
-      CreateMaterialInput<pxr::SdfAssetPath>(
-        shaderPrim,
-        "reflectionroughness_texture",
-        pxr::SdfValueTypeNames->Asset,
-        pxr::SdfAssetPath(copyPath),
-        customDataRoughnessTexture,
-        pxr::TfToken("RoughnessMap Map"),
-        pxr::TfToken("RoughnessMap"),
-        "",
-        pxr::TfToken("raw"));
-
-      std::map<pxr::TfToken, pxr::VtValue>
-        customDataRoughnessTextureInfluence =
-      {
-        {pxr::TfToken("default"), pxr::VtValue(0)},
-        {pxr::TfToken("range:max"), pxr::VtValue(1)},
-        {pxr::TfToken("range:min"), pxr::VtValue(0)}
-      };
-
-      CreateMaterialInput<bool>(
-        shaderPrim,
-        "reflection_roughness_texture_influence",
-        pxr::SdfValueTypeNames->Bool,
-        true,
-        customDataRoughnessTextureInfluence,
-        pxr::TfToken("Roughness Map Influence"),
-        pxr::TfToken("Reflectivity"),
-        "",
-        pxr::TfToken("raw"));
+      attr.Set(next[i]);
     }
+    this->dataPtr->values[i] = std::move(next[i]);
+    ++written;
   }
-  pxr::UsdShadeMaterialBindingAPI(_gprim).Bind(material);
-  return true;
+  return written;
+}
+
+//////////////////////////////////////////////////
+bool MaterialUpdater::IsValid() const
+{
+  return this->dataPtr->shaderPrim.IsValid();
+}
+
+//////////////////////////////////////////////////
+pxr::SdfPath MaterialUpdater::GetPath() const
+{
+  return this->dataPtr->path;
 }
 }  // namespace omniverse
 }  // namespace ignition
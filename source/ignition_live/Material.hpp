@@ -17,20 +17,87 @@
 #ifndef IGNITION_OMNIVERSE_MATERIAL_HPP
 #define IGNITION_OMNIVERSE_MATERIAL_HPP
 
+#include "TextureProcessor.hpp"
+#include "TextureUploader.hpp"
+
+#include <ignition/msgs/material.pb.h>
 #include <ignition/msgs/visual.pb.h>
+#include <ignition/utils/ImplPtr.hh>
 
 #include <pxr/usd/usd/stage.h>
 #include <pxr/usd/usdGeom/gprim.h>
 #include <pxr/usd/usdShade/material.h>
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 namespace ignition
 {
 namespace omniverse
 {
+/// \brief Find the files of the textures of a material.
+/// \details This modifies the ignition system paths, so it must be called
+/// from the thread that owns the stage lock.
+/// \param[in] _materialMsg material of the textures
+/// \return The full paths of the textures
+std::vector<std::string> ResolveTextures(
+    const ignition::msgs::Material& _materialMsg);
+
+/// \brief Read and hash texture files.
+/// \details The copies of the textures are named after the hash of their
+/// content, which `SetMaterial` and `MaterialUpdater` compute under the stage
+/// lock. Hashes are cached, calling this without the lock keeps the reading
+/// of the files out of it. This can be called from any thread.
+/// \param[in] _paths full paths of the textures, see `ResolveTextures`
+void HashTextures(const std::vector<std::string>& _paths);
+
 bool SetMaterial(const pxr::UsdGeomGprim& _gprim,
                  const ignition::msgs::Visual& _visualMsg,
                  const pxr::UsdStageRefPtr& _stage,
-                 const std::string& _stageDirUrl);
+                 const std::string& _stageDirUrl,
+                 TextureUploader& _textures,
+                 TextureProcessor* _processor);
+
+/// \brief Material owned by a single visual, updated in place.
+/// \details Materials authored by `SetMaterial` are shared by the visuals
+/// with the same parameters. Visuals whose material changes at runtime get
+/// their own material instead, whose shader input attributes are cached so
+/// that an update only writes the inputs whose value changed.
+class MaterialUpdater
+{
+ public:
+  /// \brief Define the material and bind it to a visual.
+  /// \param[in] _gprim geometry of the visual
+  /// \param[in] _materialPath path of the material to define
+  /// \param[in] _stage stage of the visual
+  /// \param[in] _stageDirUrl url of the directory of the stage, where the
+  /// textures are copied
+  /// \param[in] _textures uploader of the textures, it must outlive this
+  /// \param[in] _processor processor of the textures, or null
+  MaterialUpdater(const pxr::UsdGeomGprim& _gprim,
+                  const std::string& _materialPath,
+                  const pxr::UsdStageRefPtr& _stage,
+                  const std::string& _stageDirUrl,
+                  TextureUploader& _textures,
+                  TextureProcessor* _processor);
+
+  /// \brief Write the inputs that differ from the previous update. The
+  /// caller must hold the stage lock.
+  /// \param[in] _materialMsg new parameters of the material
+  /// \return The number of inputs written
+  std::size_t Update(const ignition::msgs::Material& _materialMsg);
+
+  /// \brief Whether the material is still in the stage
+  bool IsValid() const;
+
+  /// \brief Path of the material
+  pxr::SdfPath GetPath() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
 }
 }  // namespace ignition
 
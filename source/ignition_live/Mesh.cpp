@@ -17,15 +17,22 @@
 
 #include "Mesh.hpp"
 
+#include "MeshCache.hpp"
+
 #include <ignition/common/Console.hh>
 #include <ignition/common/Mesh.hh>
-#include <ignition/common/MeshManager.hh>
 #include <ignition/common/SubMesh.hh>
 #include <ignition/common/URI.hh>
 #include <ignition/common/Util.hh>
 
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usd/editContext.h>
+#include <pxr/usd/usd/payloads.h>
+#include <pxr/usd/usd/variantSets.h>
 #include <pxr/usd/usdGeom/xformCommonAPI.h>
 
+#include <string>
+
 namespace ignition::omniverse
 {
 bool endsWith(const std::string_view &str, const std::string_view &suffix)
@@ -41,19 +48,17 @@ inline std::string removeDash(const std::string &_str)
   return result;
 }
 
-pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
-                            const std::string &_path,
-                            const pxr::UsdStageRefPtr &_stage)
+std::string ResolveMeshUri(const std::string &_uri)
 {
-  ignition::common::URI uri(_meshMsg.filename());
+  ignition::common::URI uri(_uri);
   std::string fullname;
 
   std::string home;
   if (!ignition::common::env("HOME", home, false))
   {
     ignerr << "The HOME environment variable was not defined, "
-           << "so the resource [" << fullname << "] could not be found\n";
-    return pxr::UsdGeomMesh();
+           << "so the resource [" << _uri << "] could not be found\n";
+    return "";
   }
   if (uri.Scheme() == "https" || uri.Scheme() == "http")
   {
@@ -80,10 +85,28 @@ pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
   }
   else
   {
-    fullname = ignition::common::findFile(_meshMsg.filename());
+    fullname = ignition::common::findFile(_uri);
+  }
+  return fullname;
+}
+
+MaybeError<MeshData, GenericError> ConvertMesh(
+    const ignition::msgs::MeshGeom &_meshMsg, const std::string &_fullname,
+    const std::string &_path)
+{
+  auto ignMesh = LoadMesh(_fullname);
+  if (!ignMesh)
+  {
+    return GenericError("Unable to load mesh [" + _fullname + "]");
   }
+  return ConvertMesh(_meshMsg, *ignMesh, _path);
+}
 
-  auto ignMesh = ignition::common::MeshManager::Instance()->Load(fullname);
+MaybeError<MeshData, GenericError> ConvertMesh(
+    const ignition::msgs::MeshGeom &_meshMsg,
+    const ignition::common::Mesh &_ignMesh, const std::string &_path)
+{
+  const ignition::common::Mesh *ignMesh = &_ignMesh;
 
   // Some Meshes are splited in some submeshes, this loop check if the name
   // of the path is the same as the name of the submesh. In this case
@@ -109,18 +132,14 @@ pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
 
   for (unsigned int i = 0; i < ignMesh->SubMeshCount(); ++i)
   {
-    pxr::VtArray<pxr::GfVec3f> meshPoints;
-    pxr::VtArray<pxr::GfVec2f> uvs;
-    pxr::VtArray<pxr::GfVec3f> normals;
-    pxr::VtArray<int> faceVertexIndices;
-    pxr::VtArray<int> faceVertexCounts;
+    MeshData mesh;
 
     auto subMesh = ignMesh->SubMeshByIndex(i).lock();
     if (!subMesh)
     {
-      ignerr << "Unable to get a shared pointer to submesh at index [" << i
-             << "] of parent mesh [" << ignMesh->Name() << "]" << std::endl;
-      return pxr::UsdGeomMesh();
+      return GenericError(
+          "Unable to get a shared pointer to submesh at index [" +
+          std::to_string(i) + "] of parent mesh [" + ignMesh->Name() + "]");
     }
     if (isUSDPathInSubMeshName)
     {
@@ -137,28 +156,32 @@ pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
       }
     }
     // copy the submesh's vertices to the usd mesh's "points" array
+    mesh.points.reserve(subMesh->VertexCount());
     for (unsigned int v = 0; v < subMesh->VertexCount(); ++v)
     {
       const auto &vertex = subMesh->Vertex(v);
-      meshPoints.push_back(pxr::GfVec3f(vertex.X(), vertex.Y(), vertex.Z()));
+      mesh.points.push_back(pxr::GfVec3f(vertex.X(), vertex.Y(), vertex.Z()));
     }
 
     // copy the submesh's indices to the usd mesh's "faceVertexIndices" array
+    mesh.faceVertexIndices.reserve(subMesh->IndexCount());
     for (unsigned int j = 0; j < subMesh->IndexCount(); ++j)
-      faceVertexIndices.push_back(subMesh->Index(j));
+      mesh.faceVertexIndices.push_back(subMesh->Index(j));
 
     // copy the submesh's texture coordinates
+    mesh.uvs.reserve(subMesh->TexCoordCount());
     for (unsigned int j = 0; j < subMesh->TexCoordCount(); ++j)
     {
       const auto &uv = subMesh->TexCoord(j);
-      uvs.push_back(pxr::GfVec2f(uv[0], 1 - uv[1]));
+      mesh.uvs.push_back(pxr::GfVec2f(uv[0], 1 - uv[1]));
     }
 
     // copy the submesh's normals
+    mesh.normals.reserve(subMesh->NormalCount());
     for (unsigned int j = 0; j < subMesh->NormalCount(); ++j)
     {
       const auto &normal = subMesh->Normal(j);
-      normals.push_back(pxr::GfVec3f(normal[0], normal[1], normal[2]));
+      mesh.normals.push_back(pxr::GfVec3f(normal[0], normal[1], normal[2]));
     }
 
     // set the usd mesh's "faceVertexCounts" array according to
@@ -189,46 +212,19 @@ pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
       case ignition::common::SubMesh::PrimitiveType::TRIFANS:
       case ignition::common::SubMesh::PrimitiveType::TRISTRIPS:
       default:
-        ignerr << "Submesh " << subMesh->Name()
-               << " has a primitive type that is not supported." << std::endl;
-        return pxr::UsdGeomMesh();
+        return GenericError("Submesh " + subMesh->Name() +
+                            " has a primitive type that is not supported.");
     }
     // TODO(adlarkin) update this loop to allow for varying element
     // values in the array (see TODO note above). Right now, the
     // array only allows for all elements to have one value, which in
     // this case is "verticesPerFace"
-    for (unsigned int n = 0; n < numFaces; ++n)
-      faceVertexCounts.push_back(verticesPerFace);
-
-    std::string primName = _path + "/" + subMesh->Name();
-    primName = removeDash(primName);
-
-    if (endsWith(primName, "/"))
-    {
-      primName.erase(primName.size() - 1);
-    }
-
-    auto usdMesh = pxr::UsdGeomMesh::Define(_stage, pxr::SdfPath(_path));
-    usdMesh.CreatePointsAttr().Set(meshPoints);
-    usdMesh.CreateFaceVertexIndicesAttr().Set(faceVertexIndices);
-    usdMesh.CreateFaceVertexCountsAttr().Set(faceVertexCounts);
-
-    auto coordinates = usdMesh.CreatePrimvar(
-        pxr::TfToken("st"), pxr::SdfValueTypeNames->Float2Array,
-        pxr::UsdGeomTokens->vertex);
-    coordinates.Set(uvs);
-
-    usdMesh.CreateNormalsAttr().Set(normals);
-    usdMesh.SetNormalsInterpolation(pxr::TfToken("vertex"));
-
-    usdMesh.CreateSubdivisionSchemeAttr(pxr::VtValue(pxr::TfToken("none")));
+    mesh.faceVertexCounts.assign(numFaces, verticesPerFace);
 
     const auto &meshMin = ignMesh->Min();
     const auto &meshMax = ignMesh->Max();
-    pxr::VtArray<pxr::GfVec3f> extentBounds;
-    extentBounds.push_back(pxr::GfVec3f(meshMin.X(), meshMin.Y(), meshMin.Z()));
-    extentBounds.push_back(pxr::GfVec3f(meshMax.X(), meshMax.Y(), meshMax.Z()));
-    usdMesh.CreateExtentAttr().Set(extentBounds);
+    mesh.extentMin = pxr::GfVec3f(meshMin.X(), meshMin.Y(), meshMin.Z());
+    mesh.extentMax = pxr::GfVec3f(meshMax.X(), meshMax.Y(), meshMax.Z());
 
     // TODO (ahcorde): Material inside the submesh
     int materialIndex = subMesh->MaterialIndex();
@@ -249,13 +245,114 @@ pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
       // }
     }
 
-    pxr::UsdGeomXformCommonAPI meshXformAPI(usdMesh);
+    mesh.scale = pxr::GfVec3f(
+        _meshMsg.scale().x(), _meshMsg.scale().y(), _meshMsg.scale().z());
+    return mesh;
+  }
+
+  return GenericError("Mesh [" + ignMesh->Name() +
+                      "] has no submesh matching [" + _path + "]");
+}
 
-    meshXformAPI.SetScale(pxr::GfVec3f(
-        _meshMsg.scale().x(), _meshMsg.scale().y(), _meshMsg.scale().z()));
-    return usdMesh;
+/// \brief Author the arrays that change between levels of detail
+void AuthorMeshArrays(const pxr::UsdGeomMesh &_usdMesh, const MeshData &_mesh)
+{
+  _usdMesh.CreatePointsAttr().Set(_mesh.points);
+  _usdMesh.CreateFaceVertexIndicesAttr().Set(_mesh.faceVertexIndices);
+  _usdMesh.CreateFaceVertexCountsAttr().Set(_mesh.faceVertexCounts);
+
+  auto coordinates = _usdMesh.CreatePrimvar(
+      pxr::TfToken("st"), pxr::SdfValueTypeNames->Float2Array,
+      pxr::UsdGeomTokens->vertex);
+  coordinates.Set(_mesh.uvs);
+
+  _usdMesh.CreateNormalsAttr().Set(_mesh.normals);
+}
+
+pxr::UsdGeomMesh AuthorMesh(const MeshData &_mesh, const std::string &_path,
+                            const pxr::UsdStageRefPtr &_stage)
+{
+  auto usdMesh = pxr::UsdGeomMesh::Define(_stage, pxr::SdfPath(_path));
+  if (_mesh.lods.empty())
+  {
+    AuthorMeshArrays(usdMesh, _mesh);
+  }
+  else
+  {
+    auto variantSet =
+        usdMesh.GetPrim().GetVariantSets().AddVariantSet("LOD");
+    std::string variantName;
+    for (std::size_t i = 0; i <= _mesh.lods.size(); ++i)
+    {
+      variantName = "lod" + std::to_string(i);
+      variantSet.AddVariant(variantName);
+      variantSet.SetVariantSelection(variantName);
+      pxr::UsdEditContext context(variantSet.GetVariantEditContext());
+      AuthorMeshArrays(usdMesh, i == 0 ? _mesh : _mesh.lods[i - 1]);
+    }
+    variantSet.SetVariantSelection(variantName);
+  }
+  usdMesh.SetNormalsInterpolation(pxr::TfToken("vertex"));
+
+  usdMesh.CreateSubdivisionSchemeAttr(pxr::VtValue(pxr::TfToken("none")));
+
+  pxr::VtArray<pxr::GfVec3f> extentBounds;
+  extentBounds.push_back(_mesh.extentMin);
+  extentBounds.push_back(_mesh.extentMax);
+  usdMesh.CreateExtentAttr().Set(extentBounds);
+
+  pxr::UsdGeomXformCommonAPI meshXformAPI(usdMesh);
+  meshXformAPI.SetScale(_mesh.scale);
+  return usdMesh;
+}
+
+MaybeError<std::string, GenericError> WriteMeshLayer(
+    const MeshData &_mesh, const std::string &_layerUrl)
+{
+  // Authored in a layer of its own, the layer of the url may be loaded by
+  // the scene stage and must not be changed outside of its lock.
+  auto layer = pxr::SdfLayer::CreateAnonymous(".usd");
+  if (!layer)
+  {
+    return GenericError("Failed to create layer [" + _layerUrl + "]");
+  }
+
+  auto stage = pxr::UsdStage::Open(layer);
+  if (!stage)
+  {
+    return GenericError("Failed to open layer [" + _layerUrl + "]");
+  }
+  auto usdMesh = AuthorMesh(_mesh, "/Geometry", stage);
+  stage->SetDefaultPrim(usdMesh.GetPrim());
+  if (!layer->Export(_layerUrl))
+  {
+    return GenericError("Failed to save layer [" + _layerUrl + "]");
   }
+  return _layerUrl;
+}
+
+pxr::UsdGeomMesh AuthorMeshPayload(const std::string &_path,
+                                   const std::string &_assetPath,
+                                   const pxr::UsdStageRefPtr &_stage)
+{
+  auto usdMesh = pxr::UsdGeomMesh::Define(_stage, pxr::SdfPath(_path));
+  auto payloads = usdMesh.GetPrim().GetPayloads();
+  payloads.ClearPayloads();
+  payloads.AddPayload(_assetPath);
+  return usdMesh;
+}
 
-  return pxr::UsdGeomMesh();
+pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom &_meshMsg,
+                            const std::string &_path,
+                            const pxr::UsdStageRefPtr &_stage)
+{
+  auto mesh =
+      ConvertMesh(_meshMsg, ResolveMeshUri(_meshMsg.filename()), _path);
+  if (!mesh)
+  {
+    ignerr << mesh.Error() << std::endl;
+    return pxr::UsdGeomMesh();
+  }
+  return AuthorMesh(mesh.Value(), _path, _stage);
 }
 }  // namespace ignition::omniverse
@@ -17,15 +17,98 @@
 #ifndef IGNITION_OMNIVERSE_MESH_HPP
 #define IGNITION_OMNIVERSE_MESH_HPP
 
+#include "Error.hpp"
+
+#include <ignition/common/Mesh.hh>
 #include <ignition/msgs/meshgeom.pb.h>
 
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/array.h>
 #include <pxr/usd/usd/stage.h>
 #include <pxr/usd/usdGeom/mesh.h>
 
+#include <string>
+#include <vector>
+
 namespace ignition
 {
 namespace omniverse
 {
+/// \brief Geometry of a mesh converted from ign-common, ready to be authored
+/// in a stage.
+struct MeshData
+{
+  pxr::VtArray<pxr::GfVec3f> points;
+  pxr::VtArray<pxr::GfVec2f> uvs;
+  pxr::VtArray<pxr::GfVec3f> normals;
+  pxr::VtArray<int> faceVertexIndices;
+  pxr::VtArray<int> faceVertexCounts;
+  pxr::GfVec3f extentMin{0};
+  pxr::GfVec3f extentMax{0};
+  pxr::GfVec3f scale{1};
+
+  /// \brief Simplified versions of the mesh, finest first. When not empty,
+  /// the mesh is authored with a "LOD" variant set.
+  std::vector<MeshData> lods;
+};
+
+/// \brief Find the file of a mesh uri in the local filesystem.
+/// \details This modifies the ignition system paths, so it must be called
+/// from the thread that owns the stage lock.
+/// \param[in] _uri uri of the mesh, usually `MeshGeom::filename()`
+/// \return The full path of the mesh, or an empty string if it is not found.
+std::string ResolveMeshUri(const std::string& _uri);
+
+/// \brief Load a mesh and convert it to USD arrays. This doesn't touch any
+/// stage so it can be called from any thread. The loaded mesh is released
+/// once converted.
+/// \param[in] _meshMsg mesh message
+/// \param[in] _fullname full path of the mesh file, see `ResolveMeshUri`
+/// \param[in] _path USD path of the mesh, used to pick the submesh
+MaybeError<MeshData, GenericError> ConvertMesh(
+    const ignition::msgs::MeshGeom& _meshMsg, const std::string& _fullname,
+    const std::string& _path);
+
+/// \brief Convert a loaded mesh to USD arrays, see `MeshCache`.
+/// \param[in] _meshMsg mesh message
+/// \param[in] _ignMesh loaded mesh
+/// \param[in] _path USD path of the mesh, used to pick the submesh
+MaybeError<MeshData, GenericError> ConvertMesh(
+    const ignition::msgs::MeshGeom& _meshMsg,
+    const ignition::common::Mesh& _ignMesh, const std::string& _path);
+
+/// \brief Author a converted mesh in the stage.
+/// \details If the mesh has levels of detail, they are authored as the
+/// variants "lod0" (the original mesh), "lod1", ... of a "LOD" variant set.
+/// The coarsest level is selected.
+pxr::UsdGeomMesh AuthorMesh(const MeshData& _mesh, const std::string& _path,
+                            const pxr::UsdStageRefPtr& _stage);
+
+/// \brief Write a converted mesh to its own layer, so that it can be loaded
+/// on demand through a payload, see `AuthorMeshPayload`.
+/// \details The layer has a single mesh, "/Geometry", which is its default
+/// prim. An existing layer is overwritten. This doesn't touch the scene stage
+/// so it can be called from any thread, a layer of the url already loaded by
+/// the stage keeps its content until it is reloaded under the stage lock.
+/// \param[in] _mesh converted mesh
+/// \param[in] _layerUrl url of the layer to write
+/// \return The url of the layer
+MaybeError<std::string, GenericError> WriteMeshLayer(
+    const MeshData& _mesh, const std::string& _layerUrl);
+
+/// \brief Author a mesh whose geometry is behind a payload.
+/// \details Only a typed prim with a payload arc is authored in the scene
+/// stage, so it stays lightweight until the payload is loaded.
+/// \param[in] _path USD path of the mesh
+/// \param[in] _assetPath asset path of a layer written with
+/// `WriteMeshLayer`, usually relative to the root layer of `_stage`
+/// \param[in] _stage scene stage
+pxr::UsdGeomMesh AuthorMeshPayload(const std::string& _path,
+                                   const std::string& _assetPath,
+                                   const pxr::UsdStageRefPtr& _stage);
+
+/// \brief Convert and author a mesh synchronously.
 pxr::UsdGeomMesh UpdateMesh(const ignition::msgs::MeshGeom& _meshMsg,
                             const std::string& _path,
                             const pxr::UsdStageRefPtr& _stage);
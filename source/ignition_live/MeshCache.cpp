@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "MeshCache.hpp"
+
+#include <ignition/common/ColladaLoader.hh>
+#include <ignition/common/Console.hh>
+#include <ignition/common/OBJLoader.hh>
+#include <ignition/common/STLLoader.hh>
+#include <ignition/common/SubMesh.hh>
+#include <ignition/common/Util.hh>
+#include <ignition/math/Vector2.hh>
+#include <ignition/math/Vector3.hh>
+
+#include <atomic>
+#include <future>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace ignition::omniverse
+{
+//////////////////////////////////////////////////
+std::unique_ptr<ignition::common::Mesh> LoadMesh(const std::string &_fullname)
+{
+  const auto dot = _fullname.rfind('.');
+  if (dot == std::string::npos)
+  {
+    return nullptr;
+  }
+  const std::string extension =
+      ignition::common::lowercase(_fullname.substr(dot + 1));
+
+  // Same loaders as MeshManager::Load
+  std::unique_ptr<ignition::common::MeshLoader> loader;
+  if (extension == "stl" || extension == "stlb" || extension == "stla")
+  {
+    loader = std::make_unique<ignition::common::STLLoader>();
+  }
+  else if (extension == "dae")
+  {
+    loader = std::make_unique<ignition::common::ColladaLoader>();
+  }
+  else if (extension == "obj")
+  {
+    loader = std::make_unique<ignition::common::OBJLoader>();
+  }
+  else
+  {
+    ignerr << "Unsupported mesh format for file [" << _fullname << "]"
+           << std::endl;
+    return nullptr;
+  }
+  return std::unique_ptr<ignition::common::Mesh>(loader->Load(_fullname));
+}
+
+//////////////////////////////////////////////////
+std::size_t MeshBytes(const ignition::common::Mesh &_mesh)
+{
+  std::size_t bytes = 0;
+  for (unsigned int i = 0; i < _mesh.SubMeshCount(); ++i)
+  {
+    auto subMesh = _mesh.SubMeshByIndex(i).lock();
+    if (!subMesh)
+    {
+      continue;
+    }
+    bytes += subMesh->VertexCount() * sizeof(ignition::math::Vector3d) +
+             subMesh->NormalCount() * sizeof(ignition::math::Vector3d) +
+             subMesh->TexCoordCount() * sizeof(ignition::math::Vector2d) +
+             subMesh->IndexCount() * sizeof(unsigned int);
+  }
+  return bytes;
+}
+
+class MeshCache::Implementation
+{
+ public:
+  struct Entry
+  {
+    std::shared_future<MeshPtr> mesh;
+    std::list<std::string>::iterator lru;
+    std::size_t bytes = 0;
+    /// \brief False while the mesh is being loaded, it can't be evicted
+    bool loaded = false;
+  };
+
+  /// \brief Evict the least recently used meshes until the budget is met,
+  /// `mutex` must be locked.
+  void Evict();
+
+  std::size_t byteBudget = 0;
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  /// \brief Most recently used first
+  std::list<std::string> lru;
+  std::size_t cachedBytes = 0;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t evictions = 0;
+
+  /// \brief Shared with the deleters of the meshes, which may outlive the
+  /// cache.
+  std::shared_ptr<std::atomic<std::size_t>> residentBytes =
+      std::make_shared<std::atomic<std::size_t>>(0);
+};
+
+//////////////////////////////////////////////////
+void MeshCache::Implementation::Evict()
+{
+  // with no budget, keep only the meshes being loaded, so that concurrent
+  // loads of the same file still share a single load
+  auto it = this->lru.end();
+  while ((this->byteBudget == 0 || this->cachedBytes > this->byteBudget) &&
+         it != this->lru.begin())
+  {
+    --it;
+    auto entry = this->entries.find(*it);
+    if (!entry->second.loaded)
+    {
+      continue;
+    }
+    this->cachedBytes -= entry->second.bytes;
+    ++this->evictions;
+    this->entries.erase(entry);
+    it = this->lru.erase(it);
+  }
+}
+
+//////////////////////////////////////////////////
+MeshCache::MeshCache(std::size_t _byteBudget)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->byteBudget = _byteBudget;
+}
+
+//////////////////////////////////////////////////
+MaybeError<MeshCache::MeshPtr, GenericError> MeshCache::Load(
+  const std::string &_fullname)
+{
+  std::promise<MeshPtr> promise;
+  std::shared_future<MeshPtr> future;
+  bool load = false;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto it = this->dataPtr->entries.find(_fullname);
+    if (it != this->dataPtr->entries.end())
+    {
+      ++this->dataPtr->hits;
+      this->dataPtr->lru.splice(this->dataPtr->lru.begin(), this->dataPtr->lru,
+                                it->second.lru);
+      future = it->second.mesh;
+    }
+    else
+    {
+      ++this->dataPtr->misses;
+      future = promise.get_future().share();
+      this->dataPtr->lru.push_front(_fullname);
+      Implementation::Entry entry;
+      entry.mesh = future;
+      entry.lru = this->dataPtr->lru.begin();
+      this->dataPtr->entries.emplace(_fullname, std::move(entry));
+      load = true;
+    }
+  }
+
+  if (load)
+  {
+    MeshPtr mesh;
+    std::size_t bytes = 0;
+    if (auto loaded = LoadMesh(_fullname))
+    {
+      bytes = MeshBytes(*loaded);
+      auto residentBytes = this->dataPtr->residentBytes;
+      *residentBytes += bytes;
+      mesh = MeshPtr(loaded.release(),
+                     [residentBytes, bytes](const ignition::common::Mesh *_m)
+                     {
+                       *residentBytes -= bytes;
+                       delete _m;
+                     });
+    }
+    promise.set_value(mesh);
+
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto it = this->dataPtr->entries.find(_fullname);
+    if (!mesh)
+    {
+      // don't cache failures, the file may show up later
+      this->dataPtr->lru.erase(it->second.lru);
+      this->dataPtr->entries.erase(it);
+    }
+    else
+    {
+      it->second.bytes = bytes;
+      it->second.loaded = true;
+      this->dataPtr->cachedBytes += bytes;
+      this->dataPtr->Evict();
+    }
+  }
+
+  auto mesh = future.get();
+  if (!mesh)
+  {
+    return GenericError("Unable to load mesh [" + _fullname + "]");
+  }
+  return mesh;
+}
+
+//////////////////////////////////////////////////
+MeshCache::Stats MeshCache::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  Stats stats;
+  stats.residentBytes = *this->dataPtr->residentBytes;
+  stats.cachedBytes = this->dataPtr->cachedBytes;
+  stats.cachedMeshes = this->dataPtr->entries.size();
+  stats.hits = this->dataPtr->hits;
+  stats.misses = this->dataPtr->misses;
+  stats.evictions = this->dataPtr->evictions;
+  return stats;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_MESHCACHE_HPP
+#define IGNITION_OMNIVERSE_MESHCACHE_HPP
+
+#include "Error.hpp"
+
+#include <ignition/common/Mesh.hh>
+#include <ignition/utils/ImplPtr.hh>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Load a mesh file with the ign-common loaders, without registering
+/// it in the `MeshManager` singleton which would keep it forever.
+/// \details Each call uses its own loader, so it can be called from any
+/// thread.
+/// \param[in] _fullname full path of the mesh file
+/// \return The mesh owned by the caller, or null if it could not be loaded.
+std::unique_ptr<ignition::common::Mesh> LoadMesh(const std::string& _fullname);
+
+/// \brief Approximate number of bytes of the vertex data of a mesh
+std::size_t MeshBytes(const ignition::common::Mesh& _mesh);
+
+/// \brief LRU cache of source meshes, bounded in bytes.
+/// \details A file with many submeshes is referenced by many visuals, this
+/// avoids loading it once per visual. Meshes are shared with the callers, a
+/// mesh evicted from the cache is freed once the last caller releases it.
+/// Concurrent loads of the same file wait for a single load.
+class MeshCache
+{
+ public:
+  using MeshPtr = std::shared_ptr<const ignition::common::Mesh>;
+
+  struct Stats
+  {
+    /// \brief Bytes of all the source meshes alive, cached or in use
+    std::size_t residentBytes = 0;
+    /// \brief Bytes and number of the meshes kept in the cache
+    std::size_t cachedBytes = 0;
+    std::size_t cachedMeshes = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+  };
+
+  /// \param[in] _byteBudget Meshes are evicted when the cache holds more
+  /// bytes, 0 releases every mesh once its callers are done with it.
+  explicit MeshCache(std::size_t _byteBudget);
+
+  /// \brief Get a mesh from the cache, loading it if needed.
+  /// \param[in] _fullname full path of the mesh file
+  MaybeError<MeshPtr, GenericError> Load(const std::string& _fullname);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
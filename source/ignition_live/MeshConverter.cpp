@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "MeshConverter.hpp"
+
+#include "MeshSimplifier.hpp"
+#include "MeshWelder.hpp"
+#include "Metrics.hpp"
+
+#include <ignition/common/Console.hh>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ignition::omniverse
+{
+class MeshConverter::Implementation
+{
+ public:
+  struct Job
+  {
+    ignition::msgs::MeshGeom meshMsg;
+    std::string fullname;
+    std::string path;
+    Callback callback;
+    DurationStat::Clock::time_point submitted;
+  };
+
+  ~Implementation();
+
+  void Worker();
+
+  Result Convert(const ignition::msgs::MeshGeom &_meshMsg,
+                 const std::string &_fullname, const std::string &_path);
+
+  void Weld(MeshData &_mesh, const std::string &_path);
+
+  void GenerateLods(MeshData &_mesh, const std::string &_path);
+
+  Options options;
+  std::unique_ptr<MeshCache> sources;
+  std::vector<std::thread> workers;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Job> queue;
+  std::size_t inFlight = 0;
+  std::size_t completed = 0;
+  std::size_t failed = 0;
+  std::size_t weldVerticesIn = 0;
+  std::size_t weldVerticesOut = 0;
+  std::size_t weldBytesSaved = 0;
+  std::size_t weldTrianglesRemoved = 0;
+  std::size_t lodMeshes = 0;
+  std::size_t lodTrianglesIn = 0;
+  std::size_t lodTrianglesOut = 0;
+  bool stop = false;
+
+  DurationStat conversionTime;
+  DurationStat latency;
+  DurationStat lodTime;
+};
+
+//////////////////////////////////////////////////
+MeshConverter::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->cv.notify_all();
+  for (auto &worker : this->workers)
+  {
+    worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void MeshConverter::Implementation::Worker()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock, [this] { return this->stop || !this->queue.empty(); });
+      if (this->stop)
+      {
+        return;
+      }
+      job = std::move(this->queue.front());
+      this->queue.pop_front();
+      ++this->inFlight;
+    }
+
+    auto result = this->Convert(job.meshMsg, job.fullname, job.path);
+    job.callback(result);
+    this->latency.Add(DurationStat::Clock::now() - job.submitted);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    --this->inFlight;
+    if (result)
+    {
+      ++this->completed;
+    }
+    else
+    {
+      ++this->failed;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+MeshConverter::Result MeshConverter::Implementation::Convert(
+  const ignition::msgs::MeshGeom &_meshMsg, const std::string &_fullname,
+  const std::string &_path)
+{
+  ScopedTimer timer(this->conversionTime);
+  auto source = this->sources->Load(_fullname);
+  if (!source)
+  {
+    return source.Error();
+  }
+  auto result = ConvertMesh(_meshMsg, *source.Value(), _path);
+  if (!result)
+  {
+    return result;
+  }
+  MeshData mesh = result.Value();
+  // Welding first, the simplifier can't collapse edges across seams of
+  // duplicated vertices
+  this->Weld(mesh, _path);
+  this->GenerateLods(mesh, _path);
+  return mesh;
+}
+
+//////////////////////////////////////////////////
+void MeshConverter::Implementation::Weld(
+  MeshData &_mesh, const std::string &_path)
+{
+  if (!this->options.weld)
+  {
+    return;
+  }
+
+  const auto weld = WeldVertices(_mesh, this->options.weldEpsilon);
+  const std::size_t saved = weld.bytesBefore - weld.bytesAfter;
+  igndbg << "Welded [" << _path << "], vertices [" << weld.verticesBefore
+         << " -> " << weld.verticesAfter << "], saved [" << saved
+         << " bytes], removed [" << weld.degenerateTriangles
+         << "] degenerate triangles" << std::endl;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->weldVerticesIn += weld.verticesBefore;
+  this->weldVerticesOut += weld.verticesAfter;
+  this->weldBytesSaved += saved;
+  this->weldTrianglesRemoved += weld.degenerateTriangles;
+}
+
+//////////////////////////////////////////////////
+void MeshConverter::Implementation::GenerateLods(
+  MeshData &_mesh, const std::string &_path)
+{
+  const std::size_t triangles = TriangleCount(_mesh);
+  if (this->options.lodTriangleBudget == 0 ||
+      triangles <= this->options.lodTriangleBudget)
+  {
+    return;
+  }
+
+  const auto start = DurationStat::Clock::now();
+  _mesh.lods = omniverse::GenerateLods(
+    _mesh, this->options.lodTriangleBudget, this->options.lodLevels);
+  if (_mesh.lods.empty())
+  {
+    return;
+  }
+  const auto elapsed = DurationStat::Clock::now() - start;
+  this->lodTime.Add(elapsed);
+
+  const std::size_t coarsest = TriangleCount(_mesh.lods.back());
+  igndbg << "Generated [" << _mesh.lods.size() << "] levels of detail for ["
+         << _path << "], triangles [" << triangles << " -> " << coarsest
+         << "] in ["
+         << std::chrono::duration<double, std::milli>(elapsed).count()
+         << " ms]" << std::endl;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  ++this->lodMeshes;
+  this->lodTrianglesIn += triangles;
+  this->lodTrianglesOut += coarsest;
+}
+
+//////////////////////////////////////////////////
+MeshConverter::MeshConverter(const Options &_options)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->options = _options;
+  this->dataPtr->sources =
+      std::make_unique<MeshCache>(_options.sourceCacheBytes);
+  for (unsigned int i = 0; i < _options.workers; ++i)
+  {
+    this->dataPtr->workers.emplace_back(&Implementation::Worker,
+                                        this->dataPtr.get());
+  }
+}
+
+//////////////////////////////////////////////////
+MeshConverter::Result MeshConverter::Convert(
+  const ignition::msgs::MeshGeom &_meshMsg, const std::string &_fullname,
+  const std::string &_path)
+{
+  return this->dataPtr->Convert(_meshMsg, _fullname, _path);
+}
+
+//////////////////////////////////////////////////
+bool MeshConverter::Submit(const ignition::msgs::MeshGeom &_meshMsg,
+                           const std::string &_fullname,
+                           const std::string &_path, Callback _callback)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    if (this->dataPtr->workers.empty() ||
+        this->dataPtr->queue.size() >= this->dataPtr->options.maxQueueDepth)
+    {
+      return false;
+    }
+    this->dataPtr->queue.push_back({_meshMsg, _fullname, _path,
+                                    std::move(_callback),
+                                    DurationStat::Clock::now()});
+  }
+  this->dataPtr->cv.notify_one();
+  return true;
+}
+
+//////////////////////////////////////////////////
+MeshConverter::Stats MeshConverter::GetStats() const
+{
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    stats.queueDepth = this->dataPtr->queue.size();
+    stats.inFlight = this->dataPtr->inFlight;
+    stats.completed = this->dataPtr->completed;
+    stats.failed = this->dataPtr->failed;
+    stats.weldVerticesIn = this->dataPtr->weldVerticesIn;
+    stats.weldVerticesOut = this->dataPtr->weldVerticesOut;
+    stats.weldBytesSaved = this->dataPtr->weldBytesSaved;
+    stats.weldTrianglesRemoved = this->dataPtr->weldTrianglesRemoved;
+    stats.lodMeshes = this->dataPtr->lodMeshes;
+    stats.lodTrianglesIn = this->dataPtr->lodTrianglesIn;
+    stats.lodTrianglesOut = this->dataPtr->lodTrianglesOut;
+  }
+  stats.meanConversionMs = this->dataPtr->conversionTime.MeanMs();
+  stats.maxConversionMs = this->dataPtr->conversionTime.MaxMs();
+  stats.meanLatencyMs = this->dataPtr->latency.MeanMs();
+  stats.maxLatencyMs = this->dataPtr->latency.MaxMs();
+  stats.meanLodMs = this->dataPtr->lodTime.MeanMs();
+  stats.sources = this->dataPtr->sources->GetStats();
+  return stats;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_MESHCONVERTER_HPP
+#define IGNITION_OMNIVERSE_MESHCONVERTER_HPP
+
+#include "Error.hpp"
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+
+#include <ignition/msgs/meshgeom.pb.h>
+#include <ignition/utils/ImplPtr.hh>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Converts meshes in a pool of worker threads.
+/// \details Loading and building the USD arrays of a mesh runs on the
+/// workers, without holding the stage lock. Only the callback, which is
+/// expected to author the result in the stage, needs to take it.
+class MeshConverter
+{
+ public:
+  using Result = MaybeError<MeshData, GenericError>;
+  using Callback = std::function<void(const Result&)>;
+
+  struct Options
+  {
+    /// \brief Number of worker threads
+    unsigned int workers = 2;
+
+    /// \brief Maximum number of jobs waiting for a worker
+    std::size_t maxQueueDepth = 64;
+
+    /// \brief Bytes of source meshes kept after their conversion, see
+    /// `MeshCache`
+    std::size_t sourceCacheBytes = 256 * 1024 * 1024;
+
+    /// \brief Merge duplicated vertices before authoring, see `WeldVertices`
+    bool weld = false;
+
+    /// \brief Quantization used to weld vertices, 0 merges only bitwise
+    /// identical vertices
+    float weldEpsilon = 0;
+
+    /// \brief Meshes with more triangles get levels of detail, 0 disables
+    /// the generation of levels of detail.
+    std::size_t lodTriangleBudget = 0;
+
+    /// \brief Number of levels of detail, including the original mesh
+    unsigned int lodLevels = 3;
+  };
+
+  struct Stats
+  {
+    /// \brief Jobs waiting for a worker
+    std::size_t queueDepth = 0;
+    /// \brief Jobs being converted or authored
+    std::size_t inFlight = 0;
+    std::size_t completed = 0;
+    std::size_t failed = 0;
+    /// \brief Time spent loading and converting a mesh
+    double meanConversionMs = 0;
+    double maxConversionMs = 0;
+    /// \brief Time from submission until the callback returns
+    double meanLatencyMs = 0;
+    double maxLatencyMs = 0;
+    /// \brief Vertices before and after welding, and the bytes of vertex
+    /// data saved
+    std::size_t weldVerticesIn = 0;
+    std::size_t weldVerticesOut = 0;
+    std::size_t weldBytesSaved = 0;
+    /// \brief Degenerate triangles removed after welding
+    std::size_t weldTrianglesRemoved = 0;
+    /// \brief Meshes that got levels of detail
+    std::size_t lodMeshes = 0;
+    /// \brief Triangles of those meshes before and after simplification
+    /// (coarsest level)
+    std::size_t lodTrianglesIn = 0;
+    std::size_t lodTrianglesOut = 0;
+    /// \brief Time spent generating the levels of detail of a mesh
+    double meanLodMs = 0;
+    /// \brief Source meshes loaded from ign-common
+    MeshCache::Stats sources;
+  };
+
+  explicit MeshConverter(const Options &_options);
+
+  /// \brief Convert a mesh in the calling thread, applying the same
+  /// processing as the workers.
+  Result Convert(const ignition::msgs::MeshGeom& _meshMsg,
+                 const std::string& _fullname, const std::string& _path);
+
+  /// \brief Queue a mesh conversion, `_callback` is called from a worker
+  /// thread with the result.
+  /// \param[in] _meshMsg mesh message
+  /// \param[in] _fullname full path of the mesh file, see `ResolveMeshUri`
+  /// \param[in] _path USD path of the mesh
+  /// \param[in] _callback called with the converted mesh
+  /// \return false if the queue is full, the job is not queued and the caller
+  /// should convert the mesh itself.
+  bool Submit(const ignition::msgs::MeshGeom& _meshMsg,
+              const std::string& _fullname, const std::string& _path,
+              Callback _callback);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
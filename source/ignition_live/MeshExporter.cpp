@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "MeshExporter.hpp"
+
+#include "Hash.hpp"
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Filesystem.hh>
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace ignition::omniverse
+{
+class MeshExporter::Implementation
+{
+ public:
+  std::string cacheDir;
+
+  mutable std::mutex mutex;
+  /// \brief Names of the files known to be in the cache
+  std::unordered_set<std::string> cached;
+  std::size_t exported = 0;
+  std::size_t cacheHits = 0;
+  std::size_t failed = 0;
+  std::size_t bytesWritten = 0;
+};
+
+//////////////////////////////////////////////////
+MeshExporter::MeshExporter(const std::string &_cacheDir)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->cacheDir = _cacheDir;
+}
+
+//////////////////////////////////////////////////
+MeshExporter::Geometry MeshExporter::Read(const pxr::UsdGeomMesh &_mesh)
+{
+  Geometry geometry;
+  geometry.path = _mesh.GetPath().GetString();
+  _mesh.GetPointsAttr().Get(&geometry.points);
+  _mesh.GetFaceVertexCountsAttr().Get(&geometry.faceVertexCounts);
+  _mesh.GetFaceVertexIndicesAttr().Get(&geometry.faceVertexIndices);
+  pxr::TfToken orientation;
+  _mesh.GetOrientationAttr().Get(&orientation);
+  geometry.leftHanded = orientation == pxr::UsdGeomTokens->leftHanded;
+  return geometry;
+}
+
+//////////////////////////////////////////////////
+MaybeError<std::string, GenericError> MeshExporter::Export(
+  const Geometry &_mesh)
+{
+  const auto &points = _mesh.points;
+  const auto &faceVertexCounts = _mesh.faceVertexCounts;
+  const auto &faceVertexIndices = _mesh.faceVertexIndices;
+  if (points.empty() || faceVertexCounts.empty())
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    ++this->dataPtr->failed;
+    return GenericError("Mesh [" + _mesh.path + "] has no faces");
+  }
+
+  Fnv1a hash;
+  hash.Update(points.data(), points.size() * sizeof(pxr::GfVec3f));
+  hash.Update(faceVertexCounts.data(), faceVertexCounts.size() * sizeof(int));
+  hash.Update(faceVertexIndices.data(),
+              faceVertexIndices.size() * sizeof(int));
+  hash.Update(&_mesh.leftHanded, sizeof(_mesh.leftHanded));
+  const std::string name = hash.HexDigest() + ".obj";
+  const std::string fullname =
+      ignition::common::joinPaths(this->dataPtr->cacheDir, name);
+
+  std::error_code ec;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    if (this->dataPtr->cached.count(name) > 0 ||
+        std::filesystem::exists(fullname, ec))
+    {
+      this->dataPtr->cached.insert(name);
+      ++this->dataPtr->cacheHits;
+      return fullname;
+    }
+  }
+
+  // write to a temporary file first so that a later run never sees a
+  // partial mesh in the cache
+  std::filesystem::create_directories(this->dataPtr->cacheDir, ec);
+  const std::string tmp =
+      fullname + ".tmp" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream file(tmp);
+    // enough digits to read back the same floats
+    file << std::setprecision(std::numeric_limits<float>::max_digits10);
+    file << "# " << _mesh.path << "\n";
+    for (const auto &point : points)
+    {
+      file << "v " << point[0] << " " << point[1] << " " << point[2] << "\n";
+    }
+    std::size_t offset = 0;
+    const int vertexCount = static_cast<int>(points.size());
+    auto valid = [vertexCount](int _index)
+    {
+      return _index >= 0 && _index < vertexCount;
+    };
+    for (const int count : faceVertexCounts)
+    {
+      if (count < 0 || offset + count > faceVertexIndices.size())
+      {
+        break;
+      }
+      // OBJ indices are 1 based
+      const int *face = faceVertexIndices.data() + offset;
+      offset += count;
+      for (int i = 1; i + 1 < count; ++i)
+      {
+        if (!valid(face[0]) || !valid(face[i]) || !valid(face[i + 1]))
+        {
+          continue;
+        }
+        const int second = _mesh.leftHanded ? face[i + 1] : face[i];
+        const int third = _mesh.leftHanded ? face[i] : face[i + 1];
+        file << "f " << face[0] + 1 << " " << second + 1 << " "
+             << third + 1 << "\n";
+      }
+    }
+    if (!file)
+    {
+      ec = std::make_error_code(std::errc::io_error);
+    }
+  }
+  if (!ec)
+  {
+    std::filesystem::rename(tmp, fullname, ec);
+  }
+  if (ec)
+  {
+    std::filesystem::remove(tmp, ec);
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    ++this->dataPtr->failed;
+    return GenericError("Unable to export mesh [" + _mesh.path + "] to [" +
+                        fullname + "]");
+  }
+
+  const auto bytes = std::filesystem::file_size(fullname, ec);
+  igndbg << "Exported mesh [" << _mesh.path << "] to ["
+         << fullname << "], [" << points.size() << "] vertices ["
+         << faceVertexCounts.size() << "] faces" << std::endl;
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->cached.insert(name);
+  ++this->dataPtr->exported;
+  if (!ec)
+  {
+    this->dataPtr->bytesWritten += bytes;
+  }
+  return fullname;
+}
+
+//////////////////////////////////////////////////
+MeshExporter::Stats MeshExporter::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  Stats stats;
+  stats.exported = this->dataPtr->exported;
+  stats.cacheHits = this->dataPtr->cacheHits;
+  stats.failed = this->dataPtr->failed;
+  stats.bytesWritten = this->dataPtr->bytesWritten;
+  return stats;
+}
+}  // namespace ignition::omniverse
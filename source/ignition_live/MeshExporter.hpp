@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_MESHEXPORTER_HPP
+#define IGNITION_OMNIVERSE_MESHEXPORTER_HPP
+
+#include "Error.hpp"
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <pxr/usd/usdGeom/mesh.h>
+
+#include <cstddef>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Exports USD meshes to files that Ignition can load.
+/// \details Meshes are written as Wavefront OBJ files in a cache directory,
+/// named after a hash of their points and faces. A mesh already in the
+/// cache, from this run or a previous one, is not written again.
+class MeshExporter
+{
+ public:
+  struct Stats
+  {
+    /// \brief Meshes written to the cache
+    std::size_t exported = 0;
+    /// \brief Meshes found in the cache
+    std::size_t cacheHits = 0;
+    std::size_t failed = 0;
+    /// \brief Bytes of the files written
+    std::size_t bytesWritten = 0;
+  };
+
+  /// \brief Points and faces of a mesh, copied out of the stage
+  struct Geometry
+  {
+    /// \brief Path of the mesh prim
+    std::string path;
+    pxr::VtArray<pxr::GfVec3f> points;
+    pxr::VtArray<int> faceVertexCounts;
+    pxr::VtArray<int> faceVertexIndices;
+    /// \brief The faces wind clockwise, OBJ faces wind counterclockwise
+    bool leftHanded = false;
+  };
+
+  /// \param[in] _cacheDir directory of the exported meshes, created if
+  /// needed
+  explicit MeshExporter(const std::string& _cacheDir);
+
+  /// \brief Copy the geometry of a mesh, in its local space. The caller
+  /// must hold the stage lock. The arrays share their data with the stage
+  /// until it changes, so this doesn't copy the points.
+  static Geometry Read(const pxr::UsdGeomMesh& _mesh);
+
+  /// \brief Export a mesh. Faces with more than 3 vertices are triangulated
+  /// as fans. This doesn't touch the stage, call it without its lock.
+  /// \return The full path of the exported file
+  MaybeError<std::string, GenericError> Export(const Geometry& _mesh);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
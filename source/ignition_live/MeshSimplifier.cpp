@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace ignition::omniverse
+{
+namespace
+{
+struct Vec3
+{
+  double x = 0, y = 0, z = 0;
+
+  Vec3() = default;
+  Vec3(double _x, double _y, double _z) : x(_x), y(_y), z(_z) {}
+  explicit Vec3(const pxr::GfVec3f &_v) : x(_v[0]), y(_v[1]), z(_v[2]) {}
+
+  Vec3 operator+(const Vec3 &_o) const { return {x + _o.x, y + _o.y, z + _o.z}; }
+  Vec3 operator-(const Vec3 &_o) const { return {x - _o.x, y - _o.y, z - _o.z}; }
+  Vec3 operator*(double _s) const { return {x * _s, y * _s, z * _s}; }
+  double Dot(const Vec3 &_o) const { return x * _o.x + y * _o.y + z * _o.z; }
+  Vec3 Cross(const Vec3 &_o) const
+  {
+    return {y * _o.z - z * _o.y, z * _o.x - x * _o.z, x * _o.y - y * _o.x};
+  }
+  double Length() const { return std::sqrt(this->Dot(*this)); }
+  pxr::GfVec3f ToGf() const { return pxr::GfVec3f(x, y, z); }
+};
+
+/// \brief Symmetric 4x4 matrix measuring the squared distance to a set of
+/// planes.
+struct Quadric
+{
+  // a2, ab, ac, ad, b2, bc, bd, c2, cd, d2
+  double m[10] = {};
+
+  Quadric() = default;
+
+  /// \brief Quadric of the plane ax + by + cz + d = 0, scaled by _w
+  Quadric(const Vec3 &_n, double _d, double _w)
+  {
+    m[0] = _w * _n.x * _n.x; m[1] = _w * _n.x * _n.y; m[2] = _w * _n.x * _n.z;
+    m[3] = _w * _n.x * _d;   m[4] = _w * _n.y * _n.y; m[5] = _w * _n.y * _n.z;
+    m[6] = _w * _n.y * _d;   m[7] = _w * _n.z * _n.z; m[8] = _w * _n.z * _d;
+    m[9] = _w * _d * _d;
+  }
+
+  Quadric &operator+=(const Quadric &_o)
+  {
+    for (int i = 0; i < 10; ++i)
+      m[i] += _o.m[i];
+    return *this;
+  }
+
+  Quadric operator+(const Quadric &_o) const
+  {
+    Quadric q = *this;
+    q += _o;
+    return q;
+  }
+
+  double Error(const Vec3 &_v) const
+  {
+    return m[0] * _v.x * _v.x + 2 * m[1] * _v.x * _v.y +
+           2 * m[2] * _v.x * _v.z + 2 * m[3] * _v.x + m[4] * _v.y * _v.y +
+           2 * m[5] * _v.y * _v.z + 2 * m[6] * _v.y + m[7] * _v.z * _v.z +
+           2 * m[8] * _v.z + m[9];
+  }
+};
+
+/// \brief Where the vertex resulting from an edge collapse is placed
+enum class Placement : uint8_t { First, Second, Middle };
+
+struct Collapse
+{
+  double cost;
+  uint32_t a;
+  uint32_t b;
+  uint32_t stampA;
+  uint32_t stampB;
+
+  bool operator>(const Collapse &_o) const { return cost > _o.cost; }
+};
+
+/// \brief Weight of the planes added along the borders of the mesh
+constexpr double kBorderWeight = 1000.0;
+
+/// \brief Smallest cosine between the normal of a triangle before and after
+/// a collapse, collapses that fold triangles more than this are rejected.
+constexpr double kMinNormalCos = 0.2;
+
+class Simplifier
+{
+ public:
+  Simplifier(const MeshData &_mesh) : mesh(_mesh)
+  {
+    const std::size_t vertexCount = _mesh.points.size();
+    this->positions.reserve(vertexCount);
+    for (const auto &p : _mesh.points)
+      this->positions.emplace_back(p);
+    this->hasUvs = _mesh.uvs.size() == vertexCount;
+    this->hasNormals = _mesh.normals.size() == vertexCount;
+    if (this->hasUvs)
+      this->uvs.assign(_mesh.uvs.begin(), _mesh.uvs.end());
+    if (this->hasNormals)
+      this->normals.assign(_mesh.normals.begin(), _mesh.normals.end());
+
+    this->triangles.assign(_mesh.faceVertexIndices.begin(),
+                           _mesh.faceVertexIndices.end());
+    this->triangleCount = this->triangles.size() / 3;
+    this->triangleAlive.assign(this->triangleCount, true);
+    this->vertexAlive.assign(vertexCount, true);
+    this->stamps.assign(vertexCount, 0);
+    this->quadrics.assign(vertexCount, Quadric());
+    this->adjacency.resize(vertexCount);
+
+    for (uint32_t t = 0; t < this->triangleCount; ++t)
+    {
+      const uint32_t *tri = &this->triangles[t * 3];
+      const Vec3 &p0 = this->positions[tri[0]];
+      const Vec3 n = (this->positions[tri[1]] - p0)
+                         .Cross(this->positions[tri[2]] - p0);
+      const double length = n.Length();
+      for (int c = 0; c < 3; ++c)
+        this->adjacency[tri[c]].push_back(t);
+      if (length <= 0)
+        continue;
+      const Vec3 unit = n * (1.0 / length);
+      // area weighted plane
+      const Quadric q(unit, -unit.Dot(p0), 0.5 * length);
+      for (int c = 0; c < 3; ++c)
+        this->quadrics[tri[c]] += q;
+    }
+
+    // Collect the edges, an edge used by a single triangle is a border
+    std::vector<uint64_t> edges;
+    edges.reserve(this->triangles.size());
+    for (uint32_t t = 0; t < this->triangleCount; ++t)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        uint32_t u = this->triangles[t * 3 + c];
+        uint32_t v = this->triangles[t * 3 + (c + 1) % 3];
+        // degenerate triangles have edges from a vertex to itself
+        if (u == v)
+          continue;
+        edges.push_back(EdgeKey(u, v));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (std::size_t i = 0; i < edges.size();)
+    {
+      std::size_t j = i + 1;
+      while (j < edges.size() && edges[j] == edges[i])
+        ++j;
+      if (j - i == 1)
+        this->AddBorderQuadric(edges[i]);
+      i = j;
+    }
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    for (const auto key : edges)
+    {
+      this->Push(static_cast<uint32_t>(key >> 32),
+                 static_cast<uint32_t>(key & 0xffffffff));
+    }
+  }
+
+  MeshData Run(std::size_t _targetTriangles)
+  {
+    while (this->triangleCount > _targetTriangles && !this->heap.empty())
+    {
+      const Collapse collapse = this->heap.top();
+      this->heap.pop();
+      if (collapse.a == collapse.b ||
+          !this->vertexAlive[collapse.a] || !this->vertexAlive[collapse.b] ||
+          this->stamps[collapse.a] != collapse.stampA ||
+          this->stamps[collapse.b] != collapse.stampB)
+      {
+        continue;
+      }
+      this->TryCollapse(collapse.a, collapse.b);
+    }
+    return this->Compact();
+  }
+
+ private:
+  static uint64_t EdgeKey(uint32_t _u, uint32_t _v)
+  {
+    if (_u > _v)
+      std::swap(_u, _v);
+    return (static_cast<uint64_t>(_u) << 32) | _v;
+  }
+
+  void AddBorderQuadric(uint64_t _key)
+  {
+    const uint32_t u = static_cast<uint32_t>(_key >> 32);
+    const uint32_t v = static_cast<uint32_t>(_key & 0xffffffff);
+    for (const auto t : this->adjacency[u])
+    {
+      const uint32_t *tri = &this->triangles[t * 3];
+      if (tri[0] != v && tri[1] != v && tri[2] != v)
+        continue;
+      const Vec3 &p0 = this->positions[tri[0]];
+      const Vec3 faceNormal = (this->positions[tri[1]] - p0)
+                                  .Cross(this->positions[tri[2]] - p0);
+      const Vec3 edge = this->positions[v] - this->positions[u];
+      // plane containing the edge and perpendicular to the triangle
+      Vec3 n = edge.Cross(faceNormal);
+      const double length = n.Length();
+      if (length <= 0)
+        return;
+      n = n * (1.0 / length);
+      const Quadric q(n, -n.Dot(this->positions[u]),
+                      kBorderWeight * edge.Dot(edge));
+      this->quadrics[u] += q;
+      this->quadrics[v] += q;
+      return;
+    }
+  }
+
+  double Cost(uint32_t _a, uint32_t _b, Placement *_placement) const
+  {
+    const Quadric q = this->quadrics[_a] + this->quadrics[_b];
+    const Vec3 &pa = this->positions[_a];
+    const Vec3 &pb = this->positions[_b];
+    double best = q.Error(pa);
+    *_placement = Placement::First;
+    const double errorB = q.Error(pb);
+    if (errorB < best)
+    {
+      best = errorB;
+      *_placement = Placement::Second;
+    }
+    const double errorMiddle = q.Error((pa + pb) * 0.5);
+    if (errorMiddle < best)
+    {
+      best = errorMiddle;
+      *_placement = Placement::Middle;
+    }
+    return std::max(best, 0.0);
+  }
+
+  void Push(uint32_t _a, uint32_t _b)
+  {
+    if (_a == _b)
+      return;
+    Placement placement;
+    const double cost = this->Cost(_a, _b, &placement);
+    this->heap.push({cost, _a, _b, this->stamps[_a], this->stamps[_b]});
+  }
+
+  /// \brief Check that moving `_moved` to `_target` doesn't flip any of its
+  /// triangles, ignoring the ones that are removed by the collapse.
+  bool Flips(uint32_t _moved, uint32_t _other, const Vec3 &_target) const
+  {
+    for (const auto t : this->adjacency[_moved])
+    {
+      if (!this->triangleAlive[t])
+        continue;
+      const uint32_t *tri = &this->triangles[t * 3];
+      if (tri[0] == _other || tri[1] == _other || tri[2] == _other)
+        continue;
+      Vec3 before[3];
+      Vec3 after[3];
+      for (int c = 0; c < 3; ++c)
+      {
+        before[c] = this->positions[tri[c]];
+        after[c] = tri[c] == _moved ? _target : before[c];
+      }
+      const Vec3 n0 = (before[1] - before[0]).Cross(before[2] - before[0]);
+      const Vec3 n1 = (after[1] - after[0]).Cross(after[2] - after[0]);
+      const double l0 = n0.Length();
+      const double l1 = n1.Length();
+      if (l1 <= 0)
+        return true;
+      if (l0 > 0 && n0.Dot(n1) < kMinNormalCos * l0 * l1)
+        return true;
+    }
+    return false;
+  }
+
+  void TryCollapse(uint32_t _a, uint32_t _b)
+  {
+    // every triangle of _a would pass Flips and be removed
+    if (_a == _b)
+      return;
+    Placement placement;
+    this->Cost(_a, _b, &placement);
+    const Vec3 &pa = this->positions[_a];
+    const Vec3 &pb = this->positions[_b];
+    Vec3 target = placement == Placement::First ? pa :
+                  placement == Placement::Second ? pb : (pa + pb) * 0.5;
+
+    if (this->Flips(_a, _b, target) || this->Flips(_b, _a, target))
+      return;
+
+    // _b is merged into _a
+    this->positions[_a] = target;
+    if (placement == Placement::Second)
+    {
+      if (this->hasUvs)
+        this->uvs[_a] = this->uvs[_b];
+      if (this->hasNormals)
+        this->normals[_a] = this->normals[_b];
+    }
+    else if (placement == Placement::Middle)
+    {
+      if (this->hasUvs)
+        this->uvs[_a] = (this->uvs[_a] + this->uvs[_b]) * 0.5;
+      if (this->hasNormals)
+      {
+        Vec3 n = Vec3(this->normals[_a]) + Vec3(this->normals[_b]);
+        const double length = n.Length();
+        if (length > 0)
+          this->normals[_a] = (n * (1.0 / length)).ToGf();
+      }
+    }
+    this->quadrics[_a] += this->quadrics[_b];
+    this->vertexAlive[_b] = false;
+    ++this->stamps[_a];
+
+    for (const auto t : this->adjacency[_b])
+    {
+      if (!this->triangleAlive[t])
+        continue;
+      uint32_t *tri = &this->triangles[t * 3];
+      if (tri[0] == _a || tri[1] == _a || tri[2] == _a)
+      {
+        this->triangleAlive[t] = false;
+        --this->triangleCount;
+        continue;
+      }
+      for (int c = 0; c < 3; ++c)
+      {
+        if (tri[c] == _b)
+          tri[c] = _a;
+      }
+      this->adjacency[_a].push_back(t);
+    }
+    this->adjacency[_b].clear();
+    this->adjacency[_b].shrink_to_fit();
+
+    auto &adjacent = this->adjacency[_a];
+    adjacent.erase(
+        std::remove_if(adjacent.begin(), adjacent.end(),
+                       [this](uint32_t t) { return !this->triangleAlive[t]; }),
+        adjacent.end());
+
+    // Re-evaluate the edges around the merged vertex
+    std::vector<uint32_t> neighbours;
+    for (const auto t : adjacent)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        const uint32_t v = this->triangles[t * 3 + c];
+        if (v != _a)
+          neighbours.push_back(v);
+      }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                     neighbours.end());
+    for (const auto v : neighbours)
+      this->Push(_a, v);
+  }
+
+  MeshData Compact() const
+  {
+    MeshData result;
+    result.extentMin = this->mesh.extentMin;
+    result.extentMax = this->mesh.extentMax;
+    result.scale = this->mesh.scale;
+
+    constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(this->positions.size(), kUnused);
+    result.faceVertexIndices.reserve(this->triangleCount * 3);
+    for (std::size_t t = 0; t < this->triangleAlive.size(); ++t)
+    {
+      if (!this->triangleAlive[t])
+        continue;
+      for (int c = 0; c < 3; ++c)
+      {
+        const uint32_t v = this->triangles[t * 3 + c];
+        if (remap[v] == kUnused)
+        {
+          remap[v] = static_cast<uint32_t>(result.points.size());
+          result.points.push_back(this->positions[v].ToGf());
+          if (this->hasUvs)
+            result.uvs.push_back(this->uvs[v]);
+          if (this->hasNormals)
+            result.normals.push_back(this->normals[v]);
+        }
+        result.faceVertexIndices.push_back(static_cast<int>(remap[v]));
+      }
+    }
+    result.faceVertexCounts.assign(result.faceVertexIndices.size() / 3, 3);
+    return result;
+  }
+
+  const MeshData &mesh;
+  std::vector<Vec3> positions;
+  std::vector<pxr::GfVec2f> uvs;
+  std::vector<pxr::GfVec3f> normals;
+  bool hasUvs = false;
+  bool hasNormals = false;
+  std::vector<uint32_t> triangles;
+  std::size_t triangleCount = 0;
+  std::vector<bool> triangleAlive;
+  std::vector<bool> vertexAlive;
+  std::vector<uint32_t> stamps;
+  std::vector<Quadric> quadrics;
+  std::vector<std::vector<uint32_t>> adjacency;
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>
+      heap;
+};
+}  // namespace
+
+//////////////////////////////////////////////////
+std::size_t TriangleCount(const MeshData &_mesh)
+{
+  for (const auto count : _mesh.faceVertexCounts)
+  {
+    if (count != 3)
+      return 0;
+  }
+  if (_mesh.faceVertexIndices.size() != _mesh.faceVertexCounts.size() * 3)
+    return 0;
+  return _mesh.faceVertexCounts.size();
+}
+
+//////////////////////////////////////////////////
+MeshData SimplifyMesh(const MeshData &_mesh, std::size_t _targetTriangles)
+{
+  return Simplifier(_mesh).Run(_targetTriangles);
+}
+
+//////////////////////////////////////////////////
+std::vector<MeshData> GenerateLods(const MeshData &_mesh,
+                                   std::size_t _triangleBudget,
+                                   unsigned int _levels)
+{
+  std::vector<MeshData> lods;
+  const std::size_t triangles = TriangleCount(_mesh);
+  if (_triangleBudget == 0 || _levels < 2 || triangles <= _triangleBudget)
+    return lods;
+
+  // level i has triangles * (budget / triangles)^(i / (levels - 1))
+  const double ratio =
+      static_cast<double>(_triangleBudget) / static_cast<double>(triangles);
+  for (unsigned int i = 1; i < _levels; ++i)
+  {
+    const double fraction =
+        std::pow(ratio, static_cast<double>(i) / (_levels - 1));
+    const auto target = static_cast<std::size_t>(triangles * fraction);
+    // Each level is simplified from the previous one, which is cheaper and
+    // keeps the levels consistent with each other.
+    const MeshData &source = lods.empty() ? _mesh : lods.back();
+    lods.push_back(SimplifyMesh(source, target));
+  }
+  return lods;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_MESHSIMPLIFIER_HPP
+#define IGNITION_OMNIVERSE_MESHSIMPLIFIER_HPP
+
+#include "Mesh.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ignition::omniverse
+{
+/// \brief Number of triangles of a mesh, 0 if it is not a triangle mesh.
+std::size_t TriangleCount(const MeshData& _mesh);
+
+/// \brief Simplify a triangle mesh with quadric edge collapses until it has
+/// at most `_targetTriangles` triangles, or no more edges can be collapsed.
+/// \details Per vertex uvs and normals are carried along, other attributes
+/// are dropped. Border edges are weighted so that silhouettes are preserved.
+/// \param[in] _mesh mesh to simplify, it must be a triangle mesh
+/// \param[in] _targetTriangles number of triangles to reach
+/// \return The simplified mesh
+MeshData SimplifyMesh(const MeshData& _mesh, std::size_t _targetTriangles);
+
+/// \brief Generate the levels of detail of a mesh above a triangle budget.
+/// \details The triangle count of the levels decreases geometrically from
+/// the original mesh down to `_triangleBudget`.
+/// \param[in] _mesh mesh to simplify
+/// \param[in] _triangleBudget meshes with more triangles get levels of detail
+/// \param[in] _levels total number of levels, including the original mesh
+/// \return The simplified meshes, finest first. Empty if the mesh is within
+/// the budget or is not a triangle mesh.
+std::vector<MeshData> GenerateLods(const MeshData& _mesh,
+                                   std::size_t _triangleBudget,
+                                   unsigned int _levels);
+}  // namespace ignition::omniverse
+
+#endif
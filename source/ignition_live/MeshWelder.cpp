@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "MeshWelder.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ignition::omniverse
+{
+namespace
+{
+/// \brief Position, uv and normal of a vertex, quantized or as raw bits
+using VertexKey = std::int64_t[8];
+
+class KeyBuilder
+{
+ public:
+  KeyBuilder(const MeshData &_mesh, float _epsilon)
+      : mesh(_mesh),
+        hasUvs(!_mesh.uvs.empty()),
+        hasNormals(!_mesh.normals.empty()),
+        inverseEpsilon(_epsilon > 0 ? 1.0 / _epsilon : 0.0)
+  {
+  }
+
+  void Build(std::size_t _vertex, VertexKey &_key) const
+  {
+    const auto &p = this->mesh.points[_vertex];
+    _key[0] = this->Quantize(p[0]);
+    _key[1] = this->Quantize(p[1]);
+    _key[2] = this->Quantize(p[2]);
+    _key[3] = _key[4] = _key[5] = _key[6] = _key[7] = 0;
+    if (this->hasUvs)
+    {
+      const auto &uv = this->mesh.uvs[_vertex];
+      _key[3] = this->Quantize(uv[0]);
+      _key[4] = this->Quantize(uv[1]);
+    }
+    if (this->hasNormals)
+    {
+      const auto &n = this->mesh.normals[_vertex];
+      _key[5] = this->Quantize(n[0]);
+      _key[6] = this->Quantize(n[1]);
+      _key[7] = this->Quantize(n[2]);
+    }
+  }
+
+ private:
+  std::int64_t Quantize(float _value) const
+  {
+    if (this->inverseEpsilon > 0)
+    {
+      return std::llround(static_cast<double>(_value) * this->inverseEpsilon);
+    }
+    // +0 and -0 compare equal but have different bits
+    if (_value == 0)
+    {
+      return 0;
+    }
+    std::uint32_t bits;
+    std::memcpy(&bits, &_value, sizeof(bits));
+    return bits;
+  }
+
+  const MeshData &mesh;
+  bool hasUvs;
+  bool hasNormals;
+  double inverseEpsilon;
+};
+
+std::uint64_t HashKey(const VertexKey &_key)
+{
+  std::uint64_t hash = 0;
+  for (std::int64_t word : _key)
+  {
+    hash = (hash ^ static_cast<std::uint64_t>(word)) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+std::size_t VertexBytes(const MeshData &_mesh)
+{
+  return _mesh.points.size() * sizeof(pxr::GfVec3f) +
+         _mesh.uvs.size() * sizeof(pxr::GfVec2f) +
+         _mesh.normals.size() * sizeof(pxr::GfVec3f);
+}
+}  // namespace
+
+//////////////////////////////////////////////////
+WeldResult WeldVertices(MeshData &_mesh, float _epsilon)
+{
+  WeldResult result;
+  const std::size_t vertexCount = _mesh.points.size();
+  result.verticesBefore = result.verticesAfter = vertexCount;
+  result.bytesBefore = result.bytesAfter = VertexBytes(_mesh);
+
+  // The attributes must be per vertex, and the indices valid, otherwise
+  // the mesh is left untouched.
+  if (vertexCount == 0 ||
+      (!_mesh.uvs.empty() && _mesh.uvs.size() != vertexCount) ||
+      (!_mesh.normals.empty() && _mesh.normals.size() != vertexCount))
+  {
+    return result;
+  }
+  for (int index : _mesh.faceVertexIndices)
+  {
+    if (index < 0 || static_cast<std::size_t>(index) >= vertexCount)
+    {
+      return result;
+    }
+  }
+
+  const KeyBuilder keys(_mesh, _epsilon);
+
+  // Open addressing table from the key of a vertex to its new index, at most
+  // half full.
+  std::size_t capacity = 16;
+  while (capacity < vertexCount * 2)
+  {
+    capacity *= 2;
+  }
+  const std::size_t mask = capacity - 1;
+  std::vector<int> table(capacity, -1);
+  // Old index of each new vertex, to compare keys on collisions
+  std::vector<int> representatives;
+  representatives.reserve(vertexCount);
+  // New index of each old vertex, -1 until it is first used
+  std::vector<int> remap(vertexCount, -1);
+
+  VertexKey key, other;
+  for (auto &index : _mesh.faceVertexIndices)
+  {
+    if (remap[index] < 0)
+    {
+      keys.Build(index, key);
+      std::size_t slot = HashKey(key) & mask;
+      while (true)
+      {
+        const int candidate = table[slot];
+        if (candidate < 0)
+        {
+          remap[index] = static_cast<int>(representatives.size());
+          table[slot] = remap[index];
+          representatives.push_back(index);
+          break;
+        }
+        keys.Build(representatives[candidate], other);
+        if (std::memcmp(key, other, sizeof(VertexKey)) == 0)
+        {
+          remap[index] = candidate;
+          break;
+        }
+        slot = (slot + 1) & mask;
+      }
+    }
+    index = remap[index];
+  }
+
+  // Drop the triangles whose vertices were merged, other faces are kept
+  std::size_t read = 0;
+  std::size_t written = 0;
+  pxr::VtArray<int> faceVertexCounts;
+  faceVertexCounts.reserve(_mesh.faceVertexCounts.size());
+  for (const int count : _mesh.faceVertexCounts)
+  {
+    if (count < 0 || read + count > _mesh.faceVertexIndices.size())
+    {
+      break;
+    }
+    const int *face = _mesh.faceVertexIndices.data() + read;
+    read += count;
+    if (count == 3 &&
+        (face[0] == face[1] || face[1] == face[2] || face[0] == face[2]))
+    {
+      ++result.degenerateTriangles;
+      continue;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+      _mesh.faceVertexIndices[written + i] = face[i];
+    }
+    written += count;
+    faceVertexCounts.push_back(count);
+  }
+  if (result.degenerateTriangles > 0)
+  {
+    _mesh.faceVertexIndices.resize(written);
+    _mesh.faceVertexCounts = std::move(faceVertexCounts);
+  }
+
+  pxr::VtArray<pxr::GfVec3f> points;
+  pxr::VtArray<pxr::GfVec2f> uvs;
+  pxr::VtArray<pxr::GfVec3f> normals;
+  points.reserve(representatives.size());
+  if (!_mesh.uvs.empty())
+  {
+    uvs.reserve(representatives.size());
+  }
+  if (!_mesh.normals.empty())
+  {
+    normals.reserve(representatives.size());
+  }
+  for (int old : representatives)
+  {
+    points.push_back(_mesh.points[old]);
+    if (!_mesh.uvs.empty())
+    {
+      uvs.push_back(_mesh.uvs[old]);
+    }
+    if (!_mesh.normals.empty())
+    {
+      normals.push_back(_mesh.normals[old]);
+    }
+  }
+  _mesh.points = std::move(points);
+  _mesh.uvs = std::move(uvs);
+  _mesh.normals = std::move(normals);
+
+  result.verticesAfter = _mesh.points.size();
+  result.bytesAfter = VertexBytes(_mesh);
+  return result;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_MESHWELDER_HPP
+#define IGNITION_OMNIVERSE_MESHWELDER_HPP
+
+#include "Mesh.hpp"
+
+#include <cstddef>
+
+namespace ignition::omniverse
+{
+struct WeldResult
+{
+  std::size_t verticesBefore = 0;
+  std::size_t verticesAfter = 0;
+  /// \brief Bytes of the points, uvs and normals arrays before and after
+  std::size_t bytesBefore = 0;
+  std::size_t bytesAfter = 0;
+  /// \brief Triangles removed because two of their vertices were merged
+  std::size_t degenerateTriangles = 0;
+};
+
+/// \brief Merge the vertices of a mesh that have the same position, uv and
+/// normal, and drop the vertices that no face references.
+/// \details Vertices are hashed in a single pass over the indices, so this
+/// runs in linear time. The remaining vertices are ordered by first use,
+/// which also improves the locality of the index buffer.
+/// With `_epsilon` greater than 0, attributes are quantized to a grid of
+/// that size before being compared, so nearly identical vertices are merged
+/// too. Vertices that straddle a cell of the grid are not merged.
+/// With `_epsilon` equal to 0, only bitwise identical vertices are merged
+/// (except for the sign of zero).
+/// Triangles left with less than 3 distinct vertices are removed.
+/// \param[in, out] _mesh mesh to weld
+/// \param[in] _epsilon size of the quantization grid, 0 for bitwise welding
+/// \return The vertex counts and sizes before and after welding
+WeldResult WeldVertices(MeshData& _mesh, float _epsilon);
+}  // namespace ignition::omniverse
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_METRICS_HPP
+#define IGNITION_OMNIVERSE_METRICS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace ignition::omniverse
+{
+/// \brief Thread safe accumulator of duration samples.
+class DurationStat
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \brief Add a sample
+  void Add(Clock::duration _duration)
+  {
+    const double ms =
+        std::chrono::duration<double, std::milli>(_duration).count();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->count;
+    this->totalMs += ms;
+    this->maxMs = std::max(this->maxMs, ms);
+  }
+
+  /// \brief Number of samples
+  std::size_t Count() const
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->count;
+  }
+
+  /// \brief Mean of all the samples in milliseconds
+  double MeanMs() const
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->count == 0 ? 0.0 : this->totalMs / this->count;
+  }
+
+  /// \brief Largest sample in milliseconds
+  double MaxMs() const
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->maxMs;
+  }
+
+ private:
+  mutable std::mutex mutex;
+  std::size_t count = 0;
+  double totalMs = 0;
+  double maxMs = 0;
+};
+
+/// \brief Adds the time elapsed between its construction and destruction to
+/// a `DurationStat`.
+class ScopedTimer
+{
+ public:
+  explicit ScopedTimer(DurationStat& _stat)
+      : stat(_stat), start(DurationStat::Clock::now())
+  {
+  }
+
+  ~ScopedTimer() { this->stat.Add(DurationStat::Clock::now() - this->start); }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  DurationStat& stat;
+  DurationStat::Clock::time_point start;
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "OfflineBuffer.hpp"
+
+#include "AuthoringGuard.hpp"
+
+#include <ignition/common/Console.hh>
+
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/copyUtils.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ignition::omniverse
+{
+class OfflineBuffer::Implementation
+{
+ public:
+  /// \brief Copy the buffered spec of a prim to the root layer
+  void Merge(const pxr::SdfPrimSpecHandle &_spec, Stats &_stats) const;
+
+  /// \brief Copy the metadata of a prim that exists in the root layer
+  void MergeFields(const pxr::SdfPrimSpecHandle &_spec) const;
+
+  /// \brief Whether `_path` or one of its ancestors was removed
+  bool IsRemoved(const pxr::SdfPath &_path) const;
+
+  std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> stage;
+
+  /// \brief Layer of the changes, null when not buffering
+  pxr::SdfLayerRefPtr layer;
+
+  pxr::SdfLayerHandle rootLayer;
+
+  /// \brief Prims of the root layer removed while buffering
+  std::set<pxr::SdfPath> removed;
+
+  /// \brief Prims of the root layer removed then defined again while
+  /// buffering, they are replaced by the ones of the buffer
+  std::set<pxr::SdfPath> replaced;
+
+  std::atomic<bool> active{false};
+};
+
+//////////////////////////////////////////////////
+OfflineBuffer::OfflineBuffer(
+  std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> _stage)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->stage = std::move(_stage);
+}
+
+//////////////////////////////////////////////////
+void OfflineBuffer::Begin()
+{
+  // inserting the sublayer resyncs the whole stage
+  AuthoringGuard authoring;
+  auto stage = this->dataPtr->stage->Lock();
+  if (this->dataPtr->active)
+  {
+    return;
+  }
+
+  this->dataPtr->layer = pxr::SdfLayer::CreateAnonymous("offline.usda");
+  this->dataPtr->rootLayer = stage->GetRootLayer();
+  this->dataPtr->removed.clear();
+  this->dataPtr->replaced.clear();
+  stage->GetSessionLayer()->InsertSubLayerPath(
+    this->dataPtr->layer->GetIdentifier(), 0);
+  stage->SetEditTarget(pxr::UsdEditTarget(this->dataPtr->layer));
+  this->dataPtr->active = true;
+  ignmsg << "Buffering the changes of the stage until the connection is back"
+         << std::endl;
+}
+
+//////////////////////////////////////////////////
+bool OfflineBuffer::Active() const { return this->dataPtr->active; }
+
+//////////////////////////////////////////////////
+void OfflineBuffer::RemovePrim(const pxr::UsdStageRefPtr &_stage,
+                               const pxr::SdfPath &_path)
+{
+  // removes the specs of the edit target only, either the root layer or the
+  // buffer
+  _stage->RemovePrim(_path);
+  if (!this->dataPtr->active)
+  {
+    return;
+  }
+
+  // the prim comes from the root layer, hide it until the replay
+  auto prim = _stage->GetPrimAtPath(_path);
+  if (prim)
+  {
+    prim.SetActive(false);
+    this->dataPtr->removed.insert(_path);
+    this->dataPtr->replaced.erase(_path);
+  }
+}
+
+//////////////////////////////////////////////////
+bool OfflineBuffer::Restore(const pxr::UsdStageRefPtr &_stage,
+                            const pxr::SdfPath &_path)
+{
+  if (!this->dataPtr->active || this->dataPtr->removed.erase(_path) == 0)
+  {
+    return false;
+  }
+  this->dataPtr->replaced.insert(_path);
+  _stage->GetPrimAtPath(_path).ClearActive();
+  return true;
+}
+
+//////////////////////////////////////////////////
+OfflineBuffer::Stats OfflineBuffer::Replay()
+{
+  Stats stats;
+  AuthoringGuard authoring;
+  auto stage = this->dataPtr->stage->Lock();
+  if (!this->dataPtr->active)
+  {
+    return stats;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    pxr::SdfChangeBlock block;
+    // replaced prims are removed too, then copied whole from the buffer
+    for (const auto *paths :
+         {&this->dataPtr->removed, &this->dataPtr->replaced})
+    {
+      for (const auto &path : *paths)
+      {
+        pxr::SdfPrimSpecHandle spec =
+          this->dataPtr->rootLayer->GetPrimAtPath(path);
+        if (spec)
+        {
+          spec->GetRealNameParent()->RemoveNameChild(spec);
+          ++stats.removals;
+        }
+      }
+    }
+    for (const auto &spec : this->dataPtr->layer->GetRootPrims())
+    {
+      this->dataPtr->Merge(spec, stats);
+    }
+
+    auto session = stage->GetSessionLayer();
+    const std::vector<std::string> subLayers = session->GetSubLayerPaths();
+    const auto it = std::find(subLayers.begin(), subLayers.end(),
+                              this->dataPtr->layer->GetIdentifier());
+    if (it != subLayers.end())
+    {
+      session->RemoveSubLayerPath(
+        static_cast<int>(std::distance(subLayers.begin(), it)));
+    }
+  }
+  stage->SetEditTarget(pxr::UsdEditTarget(this->dataPtr->rootLayer));
+  this->dataPtr->layer = nullptr;
+  this->dataPtr->removed.clear();
+  this->dataPtr->replaced.clear();
+  this->dataPtr->active = false;
+
+  stats.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  return stats;
+}
+
+//////////////////////////////////////////////////
+void OfflineBuffer::Implementation::Merge(const pxr::SdfPrimSpecHandle &_spec,
+                                          Stats &_stats) const
+{
+  const pxr::SdfPath &path = _spec->GetPath();
+  // only holds the deactivation, the prim is already gone
+  if (this->IsRemoved(path))
+  {
+    return;
+  }
+
+  // created while disconnected, nothing to merge with
+  if (!this->rootLayer->HasSpec(path))
+  {
+    if (pxr::SdfCopySpec(this->layer, path, this->rootLayer, path))
+    {
+      ++_stats.prims;
+    }
+    else
+    {
+      ignerr << "Failed to replay [" << path << "]" << std::endl;
+    }
+    return;
+  }
+
+  this->MergeFields(_spec);
+  // attribute specs of the buffer are complete, authoring a value copies
+  // the type of the attribute from the weaker layers
+  for (const auto &property : _spec->GetProperties())
+  {
+    const pxr::SdfPath &propertyPath = property->GetPath();
+    if (pxr::SdfCopySpec(this->layer, propertyPath, this->rootLayer,
+                         propertyPath))
+    {
+      ++_stats.properties;
+    }
+    else
+    {
+      ignerr << "Failed to replay [" << propertyPath << "]" << std::endl;
+    }
+  }
+  for (const auto &child : _spec->GetNameChildren())
+  {
+    this->Merge(child, _stats);
+  }
+}
+
+//////////////////////////////////////////////////
+void OfflineBuffer::Implementation::MergeFields(
+  const pxr::SdfPrimSpecHandle &_spec) const
+{
+  const pxr::SdfPath &path = _spec->GetPath();
+  for (const auto &field : _spec->ListFields())
+  {
+    // children are merged one by one, and an "over" must not replace the
+    // specifier of the prim it overrides
+    if (field == pxr::SdfChildrenKeys->PrimChildren ||
+        field == pxr::SdfChildrenKeys->PropertyChildren ||
+        (field == pxr::SdfFieldKeys->Specifier &&
+         _spec->GetSpecifier() == pxr::SdfSpecifierOver))
+    {
+      continue;
+    }
+
+    pxr::VtValue value = this->layer->GetField(path, field);
+    if (field == pxr::SdfFieldKeys->CustomData)
+    {
+      // keep the keys that were not changed
+      pxr::VtDictionary merged =
+        this->rootLayer->GetField(path, field)
+          .GetWithDefault<pxr::VtDictionary>();
+      for (const auto &[key, entry] : value.Get<pxr::VtDictionary>())
+      {
+        merged[key] = entry;
+      }
+      value = pxr::VtValue(merged);
+    }
+    this->rootLayer->SetField(path, field, value);
+  }
+}
+
+//////////////////////////////////////////////////
+bool OfflineBuffer::Implementation::IsRemoved(const pxr::SdfPath &_path) const
+{
+  for (pxr::SdfPath path = _path; !path.IsEmpty() && !path.IsAbsoluteRootPath();
+       path = path.GetParentPath())
+  {
+    if (this->removed.count(path) > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_OFFLINEBUFFER_HPP
+#define IGNITION_OMNIVERSE_OFFLINEBUFFER_HPP
+
+#include "ThreadSafe.hpp"
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <pxr/usd/sdf/path.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace ignition::omniverse
+{
+/// \brief Keeps the changes made to the stage while the server is
+/// unreachable, and replays them once it is back.
+/// \details While buffering, the edit target of the stage is an anonymous
+/// layer, inserted as a sublayer of the session layer so that it is the
+/// strongest layer of the stage. It lives in memory and is never saved.
+/// Writing an attribute again replaces its value in that layer, so it only
+/// holds the latest state of each entity. `Replay` copies its specs to the
+/// root layer, the work and the traffic are proportional to what changed
+/// while disconnected, not to the size of the world.
+class OfflineBuffer
+{
+ public:
+  struct Stats
+  {
+    /// \brief Prims created while disconnected, copied with their children
+    std::size_t prims = 0;
+    /// \brief Properties of existing prims changed while disconnected
+    std::size_t properties = 0;
+    /// \brief Prims removed while disconnected
+    std::size_t removals = 0;
+    /// \brief Duration of the replay, in seconds
+    double seconds = 0;
+  };
+
+  explicit OfflineBuffer(
+    std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> _stage);
+
+  /// \brief Send the following changes to the buffer. Does nothing when
+  /// it is already buffering.
+  void Begin();
+
+  /// \brief Whether the changes are buffered
+  bool Active() const;
+
+  /// \brief Remove a prim of the stage. While buffering, the prim is
+  /// deactivated in the buffer and removed from the root layer by `Replay`,
+  /// otherwise it is removed right away. The caller must hold the stage
+  /// lock.
+  /// \param[in] _stage the locked stage
+  /// \param[in] _path path of the prim to remove
+  void RemovePrim(const pxr::UsdStageRefPtr &_stage,
+                  const pxr::SdfPath &_path);
+
+  /// \brief Undo the removal of a prim that is about to be defined again.
+  /// The prim is active again, and `Replay` replaces the prim of the root
+  /// layer with the one of the buffer. Does nothing if the prim was not
+  /// removed while buffering. The caller must hold the stage lock.
+  /// \param[in] _stage the locked stage
+  /// \param[in] _path path of the prim
+  /// \return true if the prim was removed while buffering, it must then be
+  /// defined whole
+  bool Restore(const pxr::UsdStageRefPtr &_stage, const pxr::SdfPath &_path);
+
+  /// \brief Copy the buffered changes to the root layer, then author the
+  /// following changes in the root layer again. Does nothing when it is
+  /// not buffering.
+  /// \return What was replayed
+  Stats Replay();
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -21,6 +21,8 @@
 
 #include <OmniClient.h>
 
+#include <memory>
+
 namespace ignition::omniverse
 {
 OmniverseLock::OmniverseLock(const std::string& _url) : url(_url)
@@ -38,24 +40,188 @@ bool CheckClientResult(OmniClientResult result)
   return result == eOmniClientResult_Ok || result == eOmniClientResult_OkLatest;
 }
 
-OmniverseSync::MaybeError<OmniClientListEntry> OmniverseSync::Stat(
-    const std::string& url) noexcept
+/// \brief Start an omniclient request whose callback fulfills a new state.
+/// \param[in] _start function starting the request, with the user data of
+/// the callback
+template <typename T, typename StartFn>
+static OmniverseRequest<T> StartRequest(StartFn _start)
+{
+  using State = typename OmniverseRequest<T>::State;
+  auto state = std::make_shared<State>();
+  // owned by the callback, the callback may run before `_start` returns
+  auto userData = new std::shared_ptr<State>(state);
+  const OmniClientRequestId id = _start(userData);
+  return OmniverseRequest<T>(state, id);
+}
+
+/// \brief Take the state of a request from the user data of its callback
+template <typename T>
+static std::shared_ptr<typename OmniverseRequest<T>::State> TakeState(
+    void* userData)
+{
+  using State = typename OmniverseRequest<T>::State;
+  std::unique_ptr<std::shared_ptr<State>> holder(
+      static_cast<std::shared_ptr<State>*>(userData));
+  return *holder;
+}
+
+static std::string CopyString(const char* str)
+{
+  return str ? std::string(str) : std::string();
+}
+
+static OmniverseEntry CopyEntry(const OmniClientListEntry& entry)
+{
+  OmniverseEntry ret;
+  ret.relativePath = CopyString(entry.relativePath);
+  ret.access = entry.access;
+  ret.flags = entry.flags;
+  ret.size = entry.size;
+  ret.modifiedTimeNs = entry.modifiedTimeNs;
+  ret.modifiedBy = CopyString(entry.modifiedBy);
+  ret.createdTimeNs = entry.createdTimeNs;
+  ret.createdBy = CopyString(entry.createdBy);
+  ret.version = CopyString(entry.version);
+  ret.hash = CopyString(entry.hash);
+  ret.comment = CopyString(entry.comment);
+  return ret;
+}
+
+OmniverseRequest<OmniverseEntry> OmniverseAsync::Stat(const std::string& _url)
+{
+  return StartRequest<OmniverseEntry>(
+      [&_url](void* userData)
+      {
+        return omniClientStat(
+            _url.c_str(), userData,
+            [](void* userData, OmniClientResult clientResult,
+               const OmniClientListEntry* entry) noexcept
+            {
+              auto state = TakeState<OmniverseEntry>(userData);
+              if (!CheckClientResult(clientResult) || !entry)
+              {
+                state->Fulfill(clientResult);
+                return;
+              }
+              state->Fulfill(CopyEntry(*entry));
+            });
+      });
+}
+
+OmniverseRequest<std::vector<OmniverseEntry>> OmniverseAsync::List(
+    const std::string& _url)
 {
-  MaybeError<OmniClientListEntry> ret(eOmniClientResult_Error);
-  omniClientWait(omniClientStat(
-      url.c_str(), &ret,
-      [](void* userData, OmniClientResult clientResult,
-         const OmniClientListEntry* entry) noexcept
+  using Entries = std::vector<OmniverseEntry>;
+  return StartRequest<Entries>(
+      [&_url](void* userData)
       {
-        auto* ret =
-            reinterpret_cast<MaybeError<OmniClientListEntry>*>(userData);
+        return omniClientList(
+            _url.c_str(), userData,
+            [](void* userData, OmniClientResult clientResult,
+               uint32_t numEntries, const OmniClientListEntry* entries) noexcept
+            {
+              auto state = TakeState<Entries>(userData);
+              if (!CheckClientResult(clientResult))
+              {
+                state->Fulfill(clientResult);
+                return;
+              }
+              Entries ret;
+              ret.reserve(numEntries);
+              for (uint32_t i = 0; i < numEntries; ++i)
+              {
+                ret.push_back(CopyEntry(entries[i]));
+              }
+              state->Fulfill(ret);
+            });
+      });
+}
+
+/// \brief Context of a copy, owned by its callback
+struct CopyContext
+{
+  std::shared_ptr<OmniverseRequest<std::string>::State> state;
+  std::string dst;
+};
+
+OmniverseRequest<std::string> OmniverseAsync::Copy(const std::string& _src,
+                                                   const std::string& _dst)
+{
+  using State = OmniverseRequest<std::string>::State;
+  auto state = std::make_shared<State>();
+  auto context = new CopyContext{state, _dst};
+  const OmniClientRequestId id = omniClientCopy(
+      _src.c_str(), _dst.c_str(), context,
+      [](void* userData, OmniClientResult clientResult) noexcept
+      {
+        std::unique_ptr<CopyContext> context(
+            static_cast<CopyContext*>(userData));
         if (!CheckClientResult(clientResult))
         {
-          *ret = clientResult;
+          context->state->Fulfill(clientResult);
           return;
         }
-        *ret = *entry;
-      }));
-  return ret;
+        context->state->Fulfill(context->dst);
+      },
+      eOmniClientCopy_Overwrite);
+  return OmniverseRequest<std::string>(state, id);
+}
+
+OmniverseRequest<std::string> OmniverseAsync::Checkpoint(
+    const std::string& _url, const std::string& _comment)
+{
+  return StartRequest<std::string>(
+      [&_url, &_comment](void* userData)
+      {
+        const bool force = true;
+        return omniClientCreateCheckpoint(
+            _url.c_str(), _comment.c_str(), force, userData,
+            [](void* userData, OmniClientResult clientResult,
+               const char* checkpointQuery) noexcept
+            {
+              auto state = TakeState<std::string>(userData);
+              if (!CheckClientResult(clientResult))
+              {
+                state->Fulfill(clientResult);
+                return;
+              }
+              state->Fulfill(CopyString(checkpointQuery));
+            });
+      });
+}
+
+OmniverseRequest<OmniverseServerInfo> OmniverseAsync::ServerInfo(
+    const std::string& _url)
+{
+  return StartRequest<OmniverseServerInfo>(
+      [&_url](void* userData)
+      {
+        return omniClientGetServerInfo(
+            _url.c_str(), userData,
+            [](void* userData, OmniClientResult clientResult,
+               const OmniClientServerInfo* info) noexcept
+            {
+              auto state = TakeState<OmniverseServerInfo>(userData);
+              if (!CheckClientResult(clientResult) || !info)
+              {
+                state->Fulfill(clientResult);
+                return;
+              }
+              OmniverseServerInfo ret;
+              ret.version = CopyString(info->version);
+              ret.username = CopyString(info->username);
+              ret.connectionId = CopyString(info->connectionId);
+              ret.cacheEnabled = info->cacheEnabled;
+              ret.checkpointsEnabled = info->checkpointsEnabled;
+              ret.undeleteEnabled = info->undeleteEnabled;
+              state->Fulfill(ret);
+            });
+      });
+}
+
+OmniverseSync::MaybeError<OmniverseEntry> OmniverseSync::Stat(
+    const std::string& url) noexcept
+{
+  return OmniverseAsync::Stat(url).Get();
 }
 }  // namespace ignition::omniverse
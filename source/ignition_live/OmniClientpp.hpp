@@ -26,8 +26,15 @@
 
 #include <OmniClient.h>
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <vector>
 
 namespace ignition::omniverse
 {
@@ -47,6 +54,200 @@ class OmniverseLock
   const std::string url;
 };
 
+/// \brief Copy of an `OmniClientListEntry`, whose strings are only valid
+/// during the omniclient callback
+struct OmniverseEntry
+{
+  std::string relativePath;
+  uint32_t access = 0;
+  uint32_t flags = 0;
+  uint64_t size = 0;
+  uint64_t modifiedTimeNs = 0;
+  std::string modifiedBy;
+  uint64_t createdTimeNs = 0;
+  std::string createdBy;
+  std::string version;
+  std::string hash;
+  std::string comment;
+};
+
+/// \brief Copy of an `OmniClientServerInfo`
+struct OmniverseServerInfo
+{
+  std::string version;
+  std::string username;
+  std::string connectionId;
+  bool cacheEnabled = false;
+  bool checkpointsEnabled = false;
+  bool undeleteEnabled = false;
+};
+
+/// \brief A running storage request, with the future of its result.
+/// \details The result is set by the callback of the request, or by
+/// `Cancel`, whichever comes first.
+template <typename T>
+class OmniverseRequest
+{
+ public:
+  using Result = MaybeError<T, OmniClientResult>;
+  using Callback = std::function<void(const Result&)>;
+
+  /// \brief Shared by the request and its callback
+  class State
+  {
+   public:
+    /// \brief Set the result and run the continuations, only the first
+    /// call has an effect
+    void Fulfill(const Result& _result)
+    {
+      std::vector<Callback> continuations;
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->fulfilled)
+        {
+          return;
+        }
+        this->fulfilled = true;
+        this->promise.set_value(_result);
+        continuations.swap(this->continuations);
+      }
+      for (const auto& continuation : continuations)
+      {
+        continuation(_result);
+      }
+    }
+
+    /// \brief Whether `Fulfill` was called
+    bool Fulfilled() const
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return this->fulfilled;
+    }
+
+    /// \brief Run a function with the result once it is set, right away
+    /// if it is set already
+    void OnDone(Callback _callback, const std::shared_future<Result>& _future)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->fulfilled)
+        {
+          this->continuations.push_back(std::move(_callback));
+          return;
+        }
+      }
+      _callback(_future.get());
+    }
+
+    std::promise<Result> promise;
+
+   private:
+    mutable std::mutex mutex;
+    bool fulfilled = false;
+    std::vector<Callback> continuations;
+  };
+
+  /// \param[in] _state state fulfilled by the callback of the request
+  /// \param[in] _cancel function stopping the request
+  OmniverseRequest(const std::shared_ptr<State>& _state,
+                   std::function<void()> _cancel)
+      : state(_state),
+        cancel(std::move(_cancel)),
+        future(_state->promise.get_future().share())
+  {
+  }
+
+  /// \param[in] _state state fulfilled by the omniclient callback
+  /// \param[in] _id id of the omniclient request
+  OmniverseRequest(const std::shared_ptr<State>& _state,
+                   OmniClientRequestId _id)
+      : OmniverseRequest(_state, [_id] { omniClientStop(_id); })
+  {
+  }
+
+  /// \brief Whether the result is available
+  bool Ready() const
+  {
+    return this->future.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  }
+
+  /// \brief Block until the result is available, or the timeout expires.
+  /// \return false if it timed out
+  bool Wait(std::chrono::milliseconds _timeout) const
+  {
+    return this->future.wait_for(_timeout) == std::future_status::ready;
+  }
+
+  /// \brief Block until the result is available
+  const Result& Get() const { return this->future.get(); }
+
+  /// \brief Block until the result is available, the request is canceled
+  /// if it isn't done after `_timeout`.
+  const Result& Get(std::chrono::milliseconds _timeout)
+  {
+    if (!this->Wait(_timeout))
+    {
+      this->Cancel();
+    }
+    return this->future.get();
+  }
+
+  /// \brief Stop the request, its result becomes
+  /// `eOmniClientResult_ErrorCanceled` unless it was already done.
+  void Cancel()
+  {
+    if (this->cancel)
+    {
+      this->cancel();
+    }
+    this->state->Fulfill(Result(eOmniClientResult_ErrorCanceled));
+  }
+
+  /// \brief Run a function with the result once it is set, from the thread
+  /// that sets it. It runs right away if the result is set already.
+  void OnDone(Callback _callback) const
+  {
+    this->state->OnDone(std::move(_callback), this->future);
+  }
+
+  /// \brief Future of the result, to wait for several requests
+  const std::shared_future<Result>& Future() const { return this->future; }
+
+ private:
+  std::shared_ptr<State> state;
+  std::function<void()> cancel;
+  std::shared_future<Result> future;
+};
+
+/// \brief Asynchronous API for omniverse.
+/// \details Each function starts a request and returns immediately, so
+/// that several requests can run at the same time.
+class OmniverseAsync
+{
+ public:
+  static OmniverseRequest<OmniverseEntry> Stat(const std::string& _url);
+
+  /// \brief List the entries of a folder
+  static OmniverseRequest<std::vector<OmniverseEntry>> List(
+    const std::string& _url);
+
+  /// \brief Copy a file, overwriting the destination
+  /// \return The url of the destination
+  static OmniverseRequest<std::string> Copy(const std::string& _src,
+                                            const std::string& _dst);
+
+  /// \brief Create a checkpoint of a file, even if it didn't change since
+  /// the last one
+  /// \return The query of the checkpoint, to append to the url
+  static OmniverseRequest<std::string> Checkpoint(const std::string& _url,
+                                                  const std::string& _comment);
+
+  /// \brief Get the info of the server of a url
+  static OmniverseRequest<OmniverseServerInfo> ServerInfo(
+    const std::string& _url);
+};
+
 /// \brief Synchronous API for omniverse
 class OmniverseSync
 {
@@ -54,7 +255,7 @@ class OmniverseSync
   template <typename T>
   using MaybeError = MaybeError<T, OmniClientResult>;
 
-  static MaybeError<OmniClientListEntry> Stat(const std::string& url) noexcept;
+  static MaybeError<OmniverseEntry> Stat(const std::string& url) noexcept;
 };
 }  // namespace ignition::omniverse
 #endif
@@ -27,6 +27,7 @@
 #include <pxr/usd/usdGeom/metrics.h>
 #include <pxr/usd/usdGeom/xform.h>
 
+#include <filesystem>
 #include <iostream>
 #include <mutex>
 #include <string>
@@ -36,23 +37,16 @@ namespace ignition
 namespace omniverse
 {
 
-// Stage URL really only needs to contain the server in the URL.  eg.
-// omniverse://ov-prod
-void PrintConnectedUsername(const std::string& stageUrl)
+void PrintConnectedUsername(
+    const OmniverseRequest<OmniverseServerInfo>& serverInfo)
 {
   // Get the username for the connection
   std::string userName("_none_");
-  omniClientWait(omniClientGetServerInfo(
-      stageUrl.c_str(), &userName,
-      [](void* userData, OmniClientResult result,
-         struct OmniClientServerInfo const* info) noexcept
-      {
-        std::string* userName = static_cast<std::string*>(userData);
-        if (userData && userName && info && info->username)
-        {
-          userName->assign(info->username);
-        }
-      }));
+  const auto& info = serverInfo.Get();
+  if (info && !info.Value().username.empty())
+  {
+    userName = info.Value().username;
+  }
   {
     std::unique_lock<std::mutex> lk(gLogMutex);
     ignmsg << "Connected username: " << userName << std::endl;
@@ -101,8 +95,8 @@ static void clientStatSubscribeCallback(
       ignmsg << "Created: " << entry->createdBy << std::endl;
       break;
     case eOmniClientListEvent_Deleted:
-      ignmsg << "Deleted: " << entry->createdBy << std::endl;
-      exit(1);
+      // the stage is still in memory, it is written again by the next save
+      ignerr << "Deleted: " << entry->createdBy << std::endl;
       break;
     case eOmniClientListEvent_Locked:
       ignmsg << "Locked: " << entry->createdBy << std::endl;
@@ -113,26 +107,15 @@ static void clientStatSubscribeCallback(
 }
 
 MaybeError<std::string, GenericError> CreateOmniverseModel(
-    const std::string& destinationPath)
+    const std::string& destinationPath, StorageBackend& storage)
 {
-  std::string stageUrl = destinationPath;
-
-  // Normalize the URL because the omniUsdLiveSetModeForUrl() interface keys off
-  // of the _normalized_ stage path
-  std::string normalizedStageUrl;
-  char* normalizedStageBuffer = nullptr;
-  size_t bufferSize = 0;
-  omniClientNormalizeUrl(stageUrl.c_str(), normalizedStageUrl.data(),
-                         &bufferSize);
-  normalizedStageUrl.reserve(bufferSize);
-  normalizedStageUrl += omniClientNormalizeUrl(
-      stageUrl.c_str(), normalizedStageUrl.data(), &bufferSize);
+  const std::string normalizedStageUrl = storage.ResolveUrl(destinationPath);
 
   // according to usd docs, `UsdStage::Open` should auto create a new stage
   // if the path doesn't exist, but this doesn't work in omniverse for
   // some reason. So we check if the path exist and use `UsdStage::CreateNew`,
   // if it does not.
-  auto entry = OmniverseSync::Stat(normalizedStageUrl);
+  auto entry = storage.Stat(normalizedStageUrl).Get();
   if (!entry)
   {
     if (entry.Error() != eOmniClientResult_ErrorNotFound)
@@ -143,13 +126,37 @@ MaybeError<std::string, GenericError> CreateOmniverseModel(
     }
     else
     {
-      auto stage = pxr::UsdStage::CreateNew(normalizedStageUrl);
+      // the stage is built in memory and copied through the storage, so
+      // that it is written like the other files of the stage
+      auto stage = pxr::UsdStage::CreateInMemory();
       // Specify ignition up-ness and units.
       pxr::UsdGeomSetStageUpAxis(stage, pxr::UsdGeomTokens->z);
       pxr::UsdGeomSetStageMetersPerUnit(stage, 1);
       stage->SetMetadata(pxr::SdfFieldKeys->Comment,
                          "Created by ignition-omniverse");
-      stage->Save();
+      // the extension is the format of the layer
+      std::string extension =
+          std::filesystem::path(normalizedStageUrl).extension().string();
+      if (extension.empty())
+      {
+        extension = ".usd";
+      }
+      std::error_code ec;
+      const auto tmp = std::filesystem::temp_directory_path(ec) /
+                       ("ignition-omniverse-stage" + extension);
+      if (ec || !stage->GetRootLayer()->Export(tmp.string()))
+      {
+        return GenericError("Failure to create stage in Omniverse (unable "
+                            "to write [" + tmp.string() + "])");
+      }
+      const auto copied = storage.Copy(tmp.string(), normalizedStageUrl).Get();
+      std::filesystem::remove(tmp, ec);
+      if (!copied)
+      {
+        auto errString = omniClientGetResultString(copied.Error());
+        return GenericError("Failure to create stage in Omniverse (" +
+                            std::string(errString) + ")");
+      }
       ignmsg << "Created omniverse stage at [" << normalizedStageUrl << "]"
              << std::endl;
     }
@@ -158,33 +165,8 @@ MaybeError<std::string, GenericError> CreateOmniverseModel(
   return normalizedStageUrl;
 }
 
-void CheckpointFile(const char* stageUrl, const char* comment)
-{
-  bool bCheckpointsSupported = false;
-  omniClientWait(omniClientGetServerInfo(
-      stageUrl, &bCheckpointsSupported,
-      [](void* UserData, OmniClientResult Result,
-         OmniClientServerInfo const* Info) noexcept
-      {
-        if (Result == eOmniClientResult_Ok && Info && UserData)
-        {
-          bool* bCheckpointsSupported = static_cast<bool*>(UserData);
-          *bCheckpointsSupported = Info->checkpointsEnabled;
-        }
-      }));
-
-  if (bCheckpointsSupported)
-  {
-    const bool bForceCheckpoint = true;
-    omniClientWait(omniClientCreateCheckpoint(
-        stageUrl, comment, bForceCheckpoint, nullptr,
-        [](void* userData, OmniClientResult result,
-           char const* checkpointQuery) noexcept {}));
-  }
-}
-
 // Startup Omniverse
-bool StartOmniverse()
+bool StartOmniverse(ConnectionState* connection)
 {
   // Register a function to be called whenever the library wants to print
   // something to a log
@@ -225,20 +207,36 @@ bool StartOmniverse()
   }
 
   omniClientRegisterConnectionStatusCallback(
-      nullptr,
+      connection,
       [](void* userData, const char* url,
          OmniClientConnectionStatus status) noexcept
       {
+        ConnectionState* state = static_cast<ConnectionState*>(userData);
         std::unique_lock<std::mutex> lk(gLogMutex);
         ignmsg << "Connection Status: "
                << omniClientGetConnectionStatusString(status) << " [" << url
                << "]" << std::endl;
-        if (status == eOmniClientConnectionStatus_ConnectError)
+        if (!state)
+        {
+          if (status == eOmniClientConnectionStatus_ConnectError)
+          {
+            // We shouldn't just exit here - we should clean up a bit, but
+            // we're going to do it anyway
+            ignerr << "Failed connection, exiting." << std::endl;
+            exit(-1);
+          }
+        }
+        else if (status == eOmniClientConnectionStatus_Connected)
+        {
+          state->connected = true;
+        }
+        else if ((status == eOmniClientConnectionStatus_ConnectError ||
+                  status == eOmniClientConnectionStatus_Disconnected) &&
+                 state->connected.exchange(false))
         {
-          // We shouldn't just exit here - we should clean up a bit, but we're
-          // going to do it anyway
-          ignerr << "Failed connection, exiting." << std::endl;
-          exit(-1);
+          ++state->losses;
+          ignwarn << "Lost connection, the changes are buffered until it is "
+                  << "back" << std::endl;
         }
       });
 
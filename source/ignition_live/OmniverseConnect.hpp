@@ -19,12 +19,15 @@
 #define IGNITION_OMNIVERSE_CONNECT_HPP
 
 #include "OmniClientpp.hpp"
+#include "StorageBackend.hpp"
 
 #include <pxr/usd/usd/stage.h>
 
 #include <OmniClient.h>
 #include <OmniUsdLive.h>
 
+#include <atomic>
+#include <cstddef>
 #include <string>
 
 // Global for making the logging reasonable
@@ -34,21 +37,36 @@ namespace ignition::omniverse
 {
 static std::string normalizedStageUrl;
 
-// Stage URL really only needs to contain the server in the URL.  eg.
-// omniverse://ov-prod
-void PrintConnectedUsername(const std::string& stageUrl);
+/// \brief Print the username of the connection.
+/// \param[in] serverInfo request of the info of the server, started by the
+/// caller so that it runs while other requests are made. Stage URL really
+/// only needs to contain the server in the URL. eg. omniverse://ov-prod
+void PrintConnectedUsername(
+    const OmniverseRequest<OmniverseServerInfo>& serverInfo);
 
 /// \brief Creates a new ignition stage in omniverse, does nothing if the
 /// stage already exists.
 /// \details The new stage is authored with ignition metadata.
+/// \param[in] storage storage of the stage
 /// \return The url of the stage
 MaybeError<std::string, GenericError> CreateOmniverseModel(
-    const std::string& destinationPath);
+    const std::string& destinationPath, StorageBackend& storage);
 
-void CheckpointFile(const char* stageUrl, const char* comment);
+/// \brief State of the connection to the server, updated by the connection
+/// status callback of omniclient
+struct ConnectionState
+{
+  /// \brief Whether the server is reachable
+  std::atomic<bool> connected{true};
+
+  /// \brief Number of times the connection was lost
+  std::atomic<std::size_t> losses{0};
+};
 
 // Startup Omniverse
-bool StartOmniverse();
+/// \param[in] connection when not null, a lost connection is recorded in it
+/// and the caller reconnects, otherwise the process exits.
+bool StartOmniverse(ConnectionState* connection = nullptr);
 }  // namespace ignition::omniverse
 
 #endif
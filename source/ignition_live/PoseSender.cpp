@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "PoseSender.hpp"
+
+#include "Metrics.hpp"
+
+#include <ignition/common/Console.hh>
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/transport/Node.hh>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace ignition::omniverse
+{
+class PoseSender::Implementation
+{
+ public:
+  ~Implementation();
+
+  void Worker();
+
+  ignition::transport::Node node;
+  std::string service;
+  unsigned int timeoutMs = 100;
+  std::thread worker;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  /// \brief Latest pose of each entity, by name
+  std::unordered_map<std::string, ignition::msgs::Pose> pending;
+  std::size_t submitted = 0;
+  std::size_t merged = 0;
+  std::size_t dropped = 0;
+  std::size_t requests = 0;
+  std::size_t failedRequests = 0;
+  bool stop = false;
+
+  DurationStat roundTrip;
+};
+
+//////////////////////////////////////////////////
+PoseSender::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->cv.notify_all();
+  if (this->worker.joinable())
+  {
+    this->worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void PoseSender::Implementation::Worker()
+{
+  while (true)
+  {
+    ignition::msgs::Pose_V req;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock,
+                    [this] { return this->stop || !this->pending.empty(); });
+      if (this->stop)
+      {
+        return;
+      }
+      for (auto &[name, pose] : this->pending)
+      {
+        *req.add_pose() = std::move(pose);
+      }
+      this->pending.clear();
+      ++this->requests;
+    }
+
+    bool result = false;
+    ignition::msgs::Boolean rep;
+    const auto start = DurationStat::Clock::now();
+    const bool executed = this->node.Request(
+      this->service, req, this->timeoutMs, rep, result);
+    if (executed)
+    {
+      this->roundTrip.Add(DurationStat::Clock::now() - start);
+    }
+
+    if (!executed || !result)
+    {
+      if (executed)
+      {
+        ignerr << "Service call failed" << std::endl;
+      }
+      else
+      {
+        ignerr << "Service [" << this->service << "] call timed out"
+               << std::endl;
+      }
+      std::lock_guard<std::mutex> lock(this->mutex);
+      ++this->failedRequests;
+      this->dropped += req.pose_size();
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+PoseSender::PoseSender(const std::string &_worldName, unsigned int _timeoutMs)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->service = "/world/" + _worldName + "/set_pose_vector";
+  this->dataPtr->timeoutMs = _timeoutMs;
+  this->dataPtr->worker =
+      std::thread(&Implementation::Worker, this->dataPtr.get());
+}
+
+//////////////////////////////////////////////////
+PoseSender::~PoseSender() = default;
+
+//////////////////////////////////////////////////
+void PoseSender::Submit(const ignition::msgs::Pose_V &_poses)
+{
+  if (_poses.pose_size() == 0)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    for (const auto &pose : _poses.pose())
+    {
+      auto [it, inserted] =
+          this->dataPtr->pending.insert_or_assign(pose.name(), pose);
+      if (!inserted)
+      {
+        ++this->dataPtr->merged;
+      }
+    }
+    this->dataPtr->submitted += _poses.pose_size();
+  }
+  this->dataPtr->cv.notify_one();
+}
+
+//////////////////////////////////////////////////
+PoseSender::Stats PoseSender::GetStats() const
+{
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    stats.submitted = this->dataPtr->submitted;
+    stats.merged = this->dataPtr->merged;
+    stats.dropped = this->dataPtr->dropped;
+    stats.pending = this->dataPtr->pending.size();
+    stats.requests = this->dataPtr->requests;
+    stats.failedRequests = this->dataPtr->failedRequests;
+  }
+  stats.meanRoundTripMs = this->dataPtr->roundTrip.MeanMs();
+  stats.maxRoundTripMs = this->dataPtr->roundTrip.MaxMs();
+  return stats;
+}
+}  // namespace ignition::omniverse
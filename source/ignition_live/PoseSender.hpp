@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_POSESENDER_HPP
+#define IGNITION_OMNIVERSE_POSESENDER_HPP
+
+#include <ignition/msgs/pose_v.pb.h>
+#include <ignition/utils/ImplPtr.hh>
+
+#include <cstddef>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Sends entity poses to Ignition from a dedicated thread.
+/// \details Poses are submitted without blocking. Those submitted while a
+/// request is running are merged, keeping the latest pose of each entity,
+/// and sent together in the next request. At most one request is in flight
+/// at a time.
+class PoseSender
+{
+ public:
+  struct Stats
+  {
+    /// \brief Poses submitted
+    std::size_t submitted = 0;
+    /// \brief Poses replaced by a newer pose of the same entity before
+    /// being sent
+    std::size_t merged = 0;
+    /// \brief Poses of the requests that failed or timed out
+    std::size_t dropped = 0;
+    /// \brief Poses waiting for the next request
+    std::size_t pending = 0;
+    std::size_t requests = 0;
+    std::size_t failedRequests = 0;
+    /// \brief Time from sending a request until its response
+    double meanRoundTripMs = 0;
+    double maxRoundTripMs = 0;
+  };
+
+  /// \param[in] _worldName poses are sent to
+  /// "/world/<_worldName>/set_pose_vector"
+  /// \param[in] _timeoutMs timeout of a request
+  PoseSender(const std::string& _worldName, unsigned int _timeoutMs = 100);
+
+  /// \brief Waits for the request in flight, the pending poses are dropped.
+  ~PoseSender();
+
+  /// \brief Queue poses to send, returns immediately. Poses are matched by
+  /// entity name.
+  void Submit(const ignition::msgs::Pose_V& _poses);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
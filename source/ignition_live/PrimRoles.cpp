@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "PrimRoles.hpp"
+
+#include <pxr/usd/usd/primRange.h>
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace ignition::omniverse
+{
+namespace
+{
+const pxr::TfToken &roleKey()
+{
+  static const pxr::TfToken key("ignition:role");
+  return key;
+}
+
+const pxr::TfToken &entityIdKey()
+{
+  static const pxr::TfToken key("ignition:entityId");
+  return key;
+}
+
+/// \brief Names of the roles in the custom data, indexed by `PrimRole`
+const std::array<std::string, 7> &roleNames()
+{
+  static const std::array<std::string, 7> names = {
+    "model", "link", "visual", "geometry", "joint", "light", "sensor"};
+  return names;
+}
+}  // namespace
+
+class PrimRoles::Implementation
+{
+ public:
+  /// \brief Closest entry of `_path` or its ancestors accepted by `_accept`
+  template <typename F>
+  pxr::SdfPath FindAncestor(const pxr::SdfPath &_path, F _accept) const;
+
+  mutable std::mutex mutex;
+  /// \brief Ordered by path so that the prims of a subtree are contiguous
+  std::map<pxr::SdfPath, PrimRoleInfo> roles;
+};
+
+//////////////////////////////////////////////////
+template <typename F>
+pxr::SdfPath PrimRoles::Implementation::FindAncestor(
+  const pxr::SdfPath &_path, F _accept) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->roles.empty())
+  {
+    return pxr::SdfPath();
+  }
+  for (auto path = _path.GetPrimPath(); !path.IsEmpty() &&
+                                        path != pxr::SdfPath::AbsoluteRootPath();
+       path = path.GetParentPath())
+  {
+    auto it = this->roles.find(path);
+    if (it != this->roles.end() && _accept(it->second))
+    {
+      return path;
+    }
+  }
+  return pxr::SdfPath();
+}
+
+//////////////////////////////////////////////////
+PrimRoles::PrimRoles()
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+}
+
+//////////////////////////////////////////////////
+void PrimRoles::Stamp(const pxr::UsdPrim &_prim, PrimRole _role,
+                      uint32_t _entityId)
+{
+  if (!_prim)
+  {
+    return;
+  }
+  _prim.SetCustomDataByKey(
+    roleKey(), pxr::VtValue(roleNames()[static_cast<std::size_t>(_role)]));
+  _prim.SetCustomDataByKey(entityIdKey(),
+                           pxr::VtValue(static_cast<unsigned int>(_entityId)));
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->roles[_prim.GetPath()] = {_role, _entityId};
+}
+
+//////////////////////////////////////////////////
+std::optional<PrimRoleInfo> PrimRoles::Find(const pxr::SdfPath &_path) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto it = this->dataPtr->roles.find(_path);
+  if (it == this->dataPtr->roles.end())
+  {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+//////////////////////////////////////////////////
+pxr::SdfPath PrimRoles::FindOwner(const pxr::SdfPath &_path) const
+{
+  return this->dataPtr->FindAncestor(
+    _path, [](const PrimRoleInfo &) { return true; });
+}
+
+//////////////////////////////////////////////////
+pxr::SdfPath PrimRoles::FindAncestor(const pxr::SdfPath &_path,
+                                     PrimRole _role) const
+{
+  return this->dataPtr->FindAncestor(
+    _path, [_role](const PrimRoleInfo &_info) { return _info.role == _role; });
+}
+
+//////////////////////////////////////////////////
+void PrimRoles::Remove(const pxr::SdfPath &_path)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto it = this->dataPtr->roles.lower_bound(_path);
+  while (it != this->dataPtr->roles.end() && it->first.HasPrefix(_path))
+  {
+    it = this->dataPtr->roles.erase(it);
+  }
+}
+
+//////////////////////////////////////////////////
+std::size_t PrimRoles::Load(const pxr::UsdStageRefPtr &_stage)
+{
+  std::size_t count = 0;
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  for (const auto &prim : pxr::UsdPrimRange::Stage(_stage))
+  {
+    const pxr::VtValue role = prim.GetCustomDataByKey(roleKey());
+    const pxr::VtValue entityId = prim.GetCustomDataByKey(entityIdKey());
+    if (!role.IsHolding<std::string>() || !entityId.IsHolding<unsigned int>())
+    {
+      continue;
+    }
+    const auto &names = roleNames();
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+      if (names[i] == role.Get<std::string>())
+      {
+        this->dataPtr->roles[prim.GetPath()] = {
+          static_cast<PrimRole>(i), entityId.Get<unsigned int>()};
+        ++count;
+        break;
+      }
+    }
+  }
+  return count;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_PRIMROLES_HPP
+#define IGNITION_OMNIVERSE_PRIMROLES_HPP
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <pxr/usd/sdf/path.h>
+#include <pxr/usd/usd/prim.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace ignition::omniverse
+{
+/// \brief What an Ignition entity became in the stage
+enum class PrimRole : int
+{
+  Model,
+  Link,
+  Visual,
+  /// \brief Geometry of a visual, its entity is the visual
+  Geometry,
+  Joint,
+  Light,
+  Sensor
+};
+
+struct PrimRoleInfo
+{
+  PrimRole role;
+  /// \brief Id of the Ignition entity
+  uint32_t entityId;
+};
+
+/// \brief Table of the prims created by the bridge, with their role.
+/// \details Prims are stamped with their role and entity id in their custom
+/// data ("ignition:role" and "ignition:entityId"), so the table can be
+/// rebuilt when the stage is opened again. Classifying a path is a lookup
+/// in a table ordered by path, prims of other clients are never mistaken
+/// for entities because of their name. This class is thread safe.
+class PrimRoles
+{
+ public:
+  PrimRoles();
+
+  /// \brief Stamp a prim created by the bridge and add it to the table.
+  /// \param[in] _prim prim of the entity
+  /// \param[in] _role role of the prim
+  /// \param[in] _entityId id of the Ignition entity
+  void Stamp(const pxr::UsdPrim& _prim, PrimRole _role, uint32_t _entityId);
+
+  /// \brief Role of a prim, only if it was created by the bridge
+  std::optional<PrimRoleInfo> Find(const pxr::SdfPath& _path) const;
+
+  /// \brief Path of the closest prim created by the bridge, `_path` itself
+  /// or one of its ancestors.
+  /// \return An empty path if the prim is not in an entity of the bridge
+  pxr::SdfPath FindOwner(const pxr::SdfPath& _path) const;
+
+  /// \brief Path of the closest prim with a role, `_path` itself or one of
+  /// its ancestors.
+  /// \return An empty path if none has this role
+  pxr::SdfPath FindAncestor(const pxr::SdfPath& _path, PrimRole _role) const;
+
+  /// \brief Remove a prim and its descendants from the table
+  void Remove(const pxr::SdfPath& _path);
+
+  /// \brief Add the prims of a stage stamped by a previous run.
+  /// \return The number of prims added
+  std::size_t Load(const pxr::UsdStageRefPtr& _stage);
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -17,15 +17,24 @@
 
 #include "Scene.hpp"
 
+#include "AuthoringGuard.hpp"
+#include "CheckpointScheduler.hpp"
 #include "FUSDLayerNoticeListener.hpp"
 #include "FUSDNoticeListener.hpp"
 #include "Material.hpp"
 #include "Mesh.hpp"
+#include "MeshConverter.hpp"
+#include "OfflineBuffer.hpp"
+#include "PrimRoles.hpp"
+#include "TextureProcessor.hpp"
+#include "TextureUploader.hpp"
 
 #include <ignition/common/Console.hh>
 #include <ignition/common/Filesystem.hh>
+#include <ignition/common/Util.hh>
 #include <ignition/math/Quaternion.hh>
 
+#include <pxr/usd/sdf/layer.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usdGeom/camera.h>
 #include <pxr/usd/usdGeom/xform.h>
@@ -34,7 +43,10 @@
 #include <pxr/usd/usdLux/sphereLight.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <iterator>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -56,6 +68,9 @@ class Scene::Implementation
   std::string stageDirUrl;
   std::unordered_map<uint32_t, pxr::UsdPrim> entities;
   std::unordered_map<std::string, uint32_t> entitiesByName;
+  /// \brief Roles of the prims created for the entities, shared with the
+  /// notice listener
+  std::shared_ptr<PrimRoles> roles = std::make_shared<PrimRoles>();
 
   std::shared_ptr<FUSDLayerNoticeListener> USDLayerNoticeListener;
   std::shared_ptr<FUSDNoticeListener> USDNoticeListener;
@@ -68,6 +83,11 @@ class Scene::Implementation
   bool UpdateScene(const ignition::msgs::Scene &_scene);
   bool UpdateVisual(const ignition::msgs::Visual &_visual,
                     const std::string &_usdPath);
+  bool AuthorMeshVisual(const MeshConverter::Result &_mesh,
+                        const ignition::msgs::Visual &_visual,
+                        const std::string &_usdGeomPath);
+  void ApplyCollisionAPI(const pxr::UsdStageRefPtr &_stage,
+                         const std::string &_usdGeomPath);
   bool UpdateLink(const ignition::msgs::Link &_link,
                   const std::string &_usdModelPath);
   bool UpdateJoint(const ignition::msgs::Joint &_joint,
@@ -83,22 +103,151 @@ class Scene::Implementation
   void CallbackJoint(const ignition::msgs::Model &_msg);
   void CallbackScene(const ignition::msgs::Scene &_scene);
   void CallbackSceneDeletion(const ignition::msgs::UInt32_V &_msg);
+  void CallbackVisualConfig(const ignition::msgs::Visual &_msg);
+
+  /// \brief Trigger a checkpoint after the next successful save, so that it
+  /// has the changes
+  void QueueCheckpoint(const std::string &_comment);
+
+  std::size_t lastMeshesProcessed = 0;
+  std::size_t lastTexturesProcessed = 0;
+  std::size_t lastTexturesResized = 0;
+  bool meshPayloads = false;
+  double noticeBatchRate = 60;
+  JointCommands jointCommands = JointCommands::PerJoint;
+
+  /// \brief Materials of the visuals updated at runtime, by visual id
+  std::unordered_map<uint32_t, std::unique_ptr<MaterialUpdater>>
+      materialUpdaters;
+  std::atomic<std::size_t> materialUpdates = 0;
+  std::atomic<std::size_t> materialInputsWritten = 0;
+  std::size_t lastMaterialUpdates = 0;
+  std::size_t lastPosesSubmitted = 0;
+  std::size_t lastNoticesReceived = 0;
+  std::size_t lastSpawnsFinished = 0;
+  std::size_t lastMeshesExported = 0;
+  std::size_t lastRemovalsActivity = 0;
+
+  /// \brief Storage of the stage and its files
+  std::shared_ptr<StorageBackend> storage;
+
+  std::unique_ptr<TextureUploader> textureUploader;
+  /// \brief Null if textures are uploaded as is. It uploads the textures
+  /// once processed, so it is declared after the uploader.
+  std::unique_ptr<TextureProcessor> textureProcessor;
+
+  /// \brief Checkpoints the stage, null if checkpoints are disabled
+  std::unique_ptr<CheckpointScheduler> checkpoints;
+  bool checkpointOnChanges = false;
+  std::size_t lastCheckpointsCreated = 0;
+  /// \brief Comments of the checkpoints waiting for the next save
+  std::mutex checkpointMutex;
+  std::vector<std::string> pendingCheckpoints;
+
+  /// \brief Changes made while the server is unreachable
+  std::unique_ptr<OfflineBuffer> offline;
+  /// \brief Payload layers of the meshes converted while offline, by url.
+  /// They are written once the changes are replayed.
+  std::mutex payloadMutex;
+  std::unordered_map<std::string, MeshData> pendingPayloads;
+
+  // Keep it last so that the workers are joined before the data they use
+  // is destroyed.
+  std::unique_ptr<MeshConverter> meshConverter;
 };
 
 //////////////////////////////////////////////////
 Scene::Scene(
   const std::string &_worldName,
   const std::string &_stageUrl,
-  Simulator _simulatorPoses)
+  Simulator _simulatorPoses,
+  const SceneOptions &_options)
     : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
 {
-  ignmsg << "Opened stage [" << _stageUrl << "]" << std::endl;
   this->dataPtr->worldName = _worldName;
-  this->dataPtr->stage = std::make_shared<ThreadSafe<pxr::UsdStageRefPtr>>(
-      pxr::UsdStage::Open(_stageUrl));
+
+  const auto openStart = std::chrono::steady_clock::now();
+  auto stage = pxr::UsdStage::Open(
+      _stageUrl, _options.loadPayloads ? pxr::UsdStage::LoadAll
+                                       : pxr::UsdStage::LoadNone);
+  const auto openEnd = std::chrono::steady_clock::now();
+  std::ptrdiff_t primCount = 0;
+  if (stage)
+  {
+    auto range = pxr::UsdPrimRange::Stage(stage);
+    primCount = std::distance(range.begin(), range.end());
+  }
+  const auto traverseEnd = std::chrono::steady_clock::now();
+  ignmsg << "Opened stage [" << _stageUrl << "] in ["
+         << std::chrono::duration<double, std::milli>(openEnd - openStart)
+                .count()
+         << " ms] with payloads "
+         << (_options.loadPayloads ? "loaded" : "unloaded") << ", traversed ["
+         << primCount << "] prims in ["
+         << std::chrono::duration<double, std::milli>(traverseEnd - openEnd)
+                .count()
+         << " ms]" << std::endl;
+  if (stage)
+  {
+    const std::size_t stamped = this->dataPtr->roles->Load(stage);
+    if (stamped > 0)
+    {
+      ignmsg << "Found [" << stamped << "] prims created by a previous run"
+             << std::endl;
+    }
+  }
+
+  this->dataPtr->stage =
+      std::make_shared<ThreadSafe<pxr::UsdStageRefPtr>>(std::move(stage));
+  this->dataPtr->offline =
+      std::make_unique<OfflineBuffer>(this->dataPtr->stage);
   this->dataPtr->stageDirUrl = ignition::common::parentPath(_stageUrl);
+  this->dataPtr->meshPayloads = _options.meshPayloads;
+  this->dataPtr->noticeBatchRate = _options.noticeBatchRate;
+  this->dataPtr->jointCommands = _options.jointCommands;
+  this->dataPtr->storage = _options.storage
+                               ? _options.storage
+                               : std::make_shared<OmniClientBackend>();
+
+  if (_options.checkpointInterval > 0 || _options.checkpointSimInterval > 0 ||
+      _options.checkpointOnChanges)
+  {
+    CheckpointScheduler::Options checkpointOptions;
+    checkpointOptions.interval = _options.checkpointInterval;
+    checkpointOptions.simInterval = _options.checkpointSimInterval;
+    checkpointOptions.minSpacing = _options.checkpointMinSpacing;
+    this->dataPtr->checkpoints = std::make_unique<CheckpointScheduler>(
+        this->dataPtr->storage, _stageUrl, checkpointOptions);
+    this->dataPtr->checkpointOnChanges = _options.checkpointOnChanges;
+  }
 
   this->dataPtr->simulatorPoses = _simulatorPoses;
+
+  this->dataPtr->textureUploader =
+      std::make_unique<TextureUploader>(_options.textureUploads, true,
+                                        _options.storage);
+  if (_options.textureMaxResolution > 0)
+  {
+    TextureProcessor::Options textureOptions;
+    textureOptions.workers = _options.textureWorkers;
+    textureOptions.maxResolution = _options.textureMaxResolution;
+    std::string home;
+    ignition::common::env("HOME", home);
+    textureOptions.cacheDir = ignition::common::joinPaths(
+        home, ".ignition", "omniverse", "textures");
+    this->dataPtr->textureProcessor =
+        std::make_unique<TextureProcessor>(textureOptions);
+  }
+
+  MeshConverter::Options meshOptions;
+  meshOptions.workers = _options.meshWorkers;
+  meshOptions.maxQueueDepth = _options.meshQueueDepth;
+  meshOptions.sourceCacheBytes = _options.meshCacheBytes;
+  meshOptions.weld = _options.meshWeld;
+  meshOptions.weldEpsilon = _options.meshWeldEpsilon;
+  meshOptions.lodTriangleBudget = _options.meshLodTriangleBudget;
+  meshOptions.lodLevels = _options.meshLodLevels;
+  this->dataPtr->meshConverter = std::make_unique<MeshConverter>(meshOptions);
 }
 
 // //////////////////////////////////////////////////
@@ -193,6 +342,7 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
   }
   this->entities[_visual.id()] = usdVisualXform.GetPrim();
   this->entitiesByName[usdVisualXform.GetPrim().GetName()] = _visual.id();
+  this->roles->Stamp(usdVisualXform.GetPrim(), PrimRole::Visual, _visual.id());
 
   std::string usdGeomPath(usdVisualPath + "/geometry");
   const auto &geom = _visual.geometry();
@@ -212,7 +362,9 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       pxr::UsdGeomXformCommonAPI cubeXformAPI(usdCube);
       cubeXformAPI.SetScale(pxr::GfVec3f(
           geom.box().size().x(), geom.box().size().y(), geom.box().size().z()));
-      if (!SetMaterial(usdCube, _visual, *stage, this->stageDirUrl))
+      if (!SetMaterial(usdCube, _visual, *stage, this->stageDirUrl,
+                       *this->textureUploader,
+                       this->textureProcessor.get()))
       {
         ignwarn << "Failed to set material" << std::endl;
       }
@@ -235,7 +387,9 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       extentBounds.push_back(-1.0 * endPoint);
       extentBounds.push_back(endPoint);
       usdCylinder.CreateExtentAttr().Set(extentBounds);
-      if (!SetMaterial(usdCylinder, _visual, *stage, this->stageDirUrl))
+      if (!SetMaterial(usdCylinder, _visual, *stage, this->stageDirUrl,
+                       *this->textureUploader,
+                       this->textureProcessor.get()))
 
       {
         ignwarn << "Failed to set material" << std::endl;
@@ -256,7 +410,9 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       pxr::UsdGeomXformCommonAPI cubeXformAPI(usdCube);
       cubeXformAPI.SetScale(
           pxr::GfVec3f(geom.plane().size().x(), geom.plane().size().y(), 0.0025));
-      if (!SetMaterial(usdCube, _visual, *stage, this->stageDirUrl))
+      if (!SetMaterial(usdCube, _visual, *stage, this->stageDirUrl,
+                       *this->textureUploader,
+                       this->textureProcessor.get()))
       {
         ignwarn << "Failed to set material" << std::endl;
       }
@@ -283,7 +439,9 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       extentBounds.push_back(pxr::GfVec3f{static_cast<float>(-maxRadii)});
       extentBounds.push_back(pxr::GfVec3f{static_cast<float>(maxRadii)});
       usdEllipsoid.CreateExtentAttr().Set(extentBounds);
-      if (!SetMaterial(usdEllipsoid, _visual, *stage, this->stageDirUrl))
+      if (!SetMaterial(usdEllipsoid, _visual, *stage, this->stageDirUrl,
+                       *this->textureUploader,
+                       this->textureProcessor.get()))
       {
         ignwarn << "Failed to set material" << std::endl;
       }
@@ -299,7 +457,9 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       extentBounds.push_back(pxr::GfVec3f(-1.0 * radius));
       extentBounds.push_back(pxr::GfVec3f(radius));
       usdSphere.CreateExtentAttr().Set(extentBounds);
-      if (!SetMaterial(usdSphere, _visual, *stage, this->stageDirUrl))
+      if (!SetMaterial(usdSphere, _visual, *stage, this->stageDirUrl,
+                       *this->textureUploader,
+                       this->textureProcessor.get()))
       {
         ignwarn << "Failed to set material" << std::endl;
       }
@@ -319,7 +479,9 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       extentBounds.push_back(-1.0 * endPoint);
       extentBounds.push_back(endPoint);
       usdCapsule.CreateExtentAttr().Set(extentBounds);
-      if (!SetMaterial(usdCapsule, _visual, *stage, this->stageDirUrl))
+      if (!SetMaterial(usdCapsule, _visual, *stage, this->stageDirUrl,
+                       *this->textureUploader,
+                       this->textureProcessor.get()))
       {
         ignwarn << "Failed to set material" << std::endl;
       }
@@ -327,20 +489,28 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
     }
     case ignition::msgs::Geometry::MESH:
     {
-      auto usdMesh = UpdateMesh(geom.mesh(), usdGeomPath, *stage);
-      if (!usdMesh)
+      const std::string fullname = ResolveMeshUri(geom.mesh().filename());
+      // the textures are found here, under the lock, and read by the worker
+      std::vector<std::string> textures;
+      if (_visual.has_material())
       {
-        ignerr << "Failed to update visual [" << _visual.name() << "]"
-               << std::endl;
-        return false;
+        textures = ResolveTextures(_visual.material());
       }
-      if (!SetMaterial(usdMesh, _visual, *stage, this->stageDirUrl))
+      auto author = [this, _visual, usdGeomPath, textures](
+                        const MeshConverter::Result &_mesh)
       {
-        ignerr << "Failed to update visual [" << _visual.name() << "]"
-               << std::endl;
-        return false;
+        HashTextures(textures);
+        this->AuthorMeshVisual(_mesh, _visual, usdGeomPath);
+      };
+      if (this->meshConverter->Submit(
+            geom.mesh(), fullname, usdGeomPath, author))
+      {
+        return true;
       }
-      break;
+      // no worker available, convert the mesh in this thread
+      return this->AuthorMeshVisual(
+        this->meshConverter->Convert(geom.mesh(), fullname, usdGeomPath),
+        _visual, usdGeomPath);
     }
     default:
       ignerr << "Failed to update geometry (unsuported geometry type '"
@@ -348,12 +518,110 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
       return false;
   }
 
+  this->roles->Stamp(stage->GetPrimAtPath(pxr::SdfPath(usdGeomPath)),
+                     PrimRole::Geometry, _visual.id());
+  this->ApplyCollisionAPI(*stage, usdGeomPath);
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Scene::Implementation::AuthorMeshVisual(
+  const MeshConverter::Result &_mesh,
+  const ignition::msgs::Visual &_visual,
+  const std::string &_usdGeomPath)
+{
+  AuthoringGuard authoring;
+  // The payload layer is independent of the scene stage, write it before
+  // taking the lock.
+  std::string payloadPath;
+  std::string payloadUrl;
+  if (_mesh && this->meshPayloads)
+  {
+    payloadPath = "./payloads" + _usdGeomPath + ".usd";
+    payloadUrl = this->stageDirUrl + "/payloads" + _usdGeomPath + ".usd";
+    // while the server is unreachable the payload is referenced already,
+    // its layer is written once the changes are replayed
+    auto defer = [this, &_mesh, &payloadUrl]
+    {
+      std::lock_guard<std::mutex> lock(this->payloadMutex);
+      if (!this->offline->Active())
+      {
+        return false;
+      }
+      this->pendingPayloads[payloadUrl] = _mesh.Value();
+      return true;
+    };
+    if (!defer())
+    {
+      auto layer = WriteMeshLayer(_mesh.Value(), payloadUrl);
+      // the connection may have been lost in the meantime
+      if (!layer && !defer())
+      {
+        ignerr << layer.Error() << std::endl;
+        ignerr << "Failed to update visual [" << _visual.name() << "]"
+               << std::endl;
+        return false;
+      }
+    }
+  }
+
+  auto stage = this->stage->Lock();
+
+  // The visual may have been removed while the mesh was being converted
+  if (!stage->GetPrimAtPath(pxr::SdfPath(_usdGeomPath).GetParentPath()))
+  {
+    return false;
+  }
+
+  if (!_mesh)
+  {
+    ignerr << _mesh.Error() << std::endl;
+    ignerr << "Failed to update visual [" << _visual.name() << "]"
+           << std::endl;
+    return false;
+  }
+  // the stage keeps the previous geometry of a payload it already loaded
+  if (!payloadUrl.empty())
+  {
+    if (auto loaded = pxr::SdfLayer::Find(payloadUrl))
+    {
+      loaded->Reload();
+    }
+  }
+  auto usdMesh =
+      payloadPath.empty()
+          ? AuthorMesh(_mesh.Value(), _usdGeomPath, *stage)
+          : AuthorMeshPayload(_usdGeomPath, payloadPath, *stage);
+  if (!usdMesh)
+  {
+    ignerr << "Failed to update visual [" << _visual.name() << "]"
+           << std::endl;
+    return false;
+  }
+  if (!SetMaterial(usdMesh, _visual, *stage, this->stageDirUrl,
+                   *this->textureUploader, this->textureProcessor.get()))
+  {
+    ignerr << "Failed to update visual [" << _visual.name() << "]"
+           << std::endl;
+    return false;
+  }
+  this->roles->Stamp(usdMesh.GetPrim(), PrimRole::Geometry, _visual.id());
+  this->ApplyCollisionAPI(*stage, _usdGeomPath);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void Scene::Implementation::ApplyCollisionAPI(
+  const pxr::UsdStageRefPtr &_stage,
+  const std::string &_usdGeomPath)
+{
   // TODO(ahcorde): When usdphysics will be available in nv-usd we should
   // replace this code with pxr::UsdPhysicsCollisionAPI::Apply(geomPrim)
   pxr::TfToken appliedSchemaNamePhysicsCollisionAPI("PhysicsCollisionAPI");
   pxr::SdfPrimSpecHandle primSpec = pxr::SdfCreatePrimInLayer(
-          stage->GetEditTarget().GetLayer(),
-          pxr::SdfPath(usdGeomPath));
+          _stage->GetEditTarget().GetLayer(),
+          pxr::SdfPath(_usdGeomPath));
   pxr::SdfTokenListOp listOpPanda;
   // Use ReplaceOperations to append in place.
   if (!listOpPanda.ReplaceOperations(pxr::SdfListOpTypeExplicit,
@@ -362,8 +630,6 @@ bool Scene::Implementation::UpdateVisual(const ignition::msgs::Visual &_visual,
   }
   primSpec->SetInfo(
     pxr::UsdTokens->apiSchemas, pxr::VtValue::Take(listOpPanda));
-
-  return true;
 }
 
 //////////////////////////////////////////////////
@@ -409,6 +675,7 @@ bool Scene::Implementation::UpdateLink(const ignition::msgs::Link &_link,
   }
   this->entities[_link.id()] = xform.GetPrim();
   this->entitiesByName[xform.GetPrim().GetName()] = _link.id();
+  this->roles->Stamp(xform.GetPrim(), PrimRole::Link, _link.id());
 
   for (const auto &visual : _link.visual())
   {
@@ -466,6 +733,7 @@ bool Scene::Implementation::UpdateJoint(
           auto jointFixedUSD = stage->DefinePrim(
             pxr::SdfPath("/" + this->worldName + "/" + _joint.name()),
             usdPrimTypeName);
+          this->roles->Stamp(jointFixedUSD, PrimRole::Joint, _joint.id());
 
           auto body0 = jointFixedUSD.CreateRelationship(
             pxr::TfToken("physics:body0"), false);
@@ -495,6 +763,7 @@ bool Scene::Implementation::UpdateJoint(
           auto revoluteJointUSD = stage->DefinePrim(
             pxr::SdfPath("/" + this->worldName + "/" + _joint.name()),
             usdPrimTypeName);
+          this->roles->Stamp(revoluteJointUSD, PrimRole::Joint, _joint.id());
 
           igndbg << "\tParent "
                  << "/" + this->worldName + "/" + _joint.parent() << '\n';
@@ -655,97 +924,94 @@ bool Scene::Implementation::UpdateModel(const ignition::msgs::Model &_model)
   if (modelName.empty())
     return true;
 
-  auto range = pxr::UsdPrimRange::Stage(*stage);
-  for (auto const &prim : range)
+  std::replace(modelName.begin(), modelName.end(), ' ', '_');
+  const std::string usdModelPath = "/" + worldName + "/" + modelName;
+  // removed while offline, the old prim is replaced by the new one
+  const bool restored =
+      this->offline->Restore(*stage, pxr::SdfPath(usdModelPath));
+
+  // The model is already in the stage, probably from a previous run or
+  // authored by IsaacSim, only look for its entities.
+  auto prim = stage->GetPrimAtPath(pxr::SdfPath(usdModelPath));
+  if (prim && !restored)
   {
-    if (prim.GetName().GetString() == modelName)
-    {
-      ignwarn << "The model [" << _model.name() << "] is already available"
-              << " in Isaac Sim" << std::endl;
+    ignwarn << "The model [" << _model.name() << "] is already available"
+            << " in Isaac Sim" << std::endl;
 
-      std::string usdModelPath = "/" + worldName + "/" + modelName;
-      auto prim = stage->GetPrimAtPath(
-            pxr::SdfPath(usdModelPath));
-      if (prim)
-      {
-        this->entities[_model.id()] = prim;
-        this->entitiesByName[prim.GetName()] = _model.id();
+    this->entities[_model.id()] = prim;
+    this->entitiesByName[prim.GetName()] = _model.id();
+    this->roles->Stamp(prim, PrimRole::Model, _model.id());
 
-        for (const auto &link : _model.link())
+    for (const auto &link : _model.link())
+    {
+      std::string linkName = link.name();
+      std::string suffix = "_link";
+      std::size_t found = linkName.find("_link");
+      if (found != std::string::npos)
+      {
+        suffix = "";
+      }
+      std::string usdLinkPath = usdModelPath + "/" + linkName + suffix;
+      auto linkPrim = stage->GetPrimAtPath(
+            pxr::SdfPath(usdLinkPath));
+      if (!linkPrim)
+      {
+        usdLinkPath = usdModelPath + "/" + linkName;
+        linkPrim = stage->GetPrimAtPath(
+              pxr::SdfPath(usdLinkPath));
+      }
+      if (linkPrim)
+      {
+        this->entities[link.id()] = linkPrim;
+        this->entitiesByName[linkPrim.GetName()] = link.id();
+        this->roles->Stamp(linkPrim, PrimRole::Link, link.id());
+        for (const auto &visual : link.visual())
         {
-          std::string linkName = link.name();
-          std::string suffix = "_link";
-          std::size_t found = linkName.find("_link");
+          std::string visualName = visual.name();
+          std::string suffix = "_visual";
+          std::size_t found = visualName.find("_visual");
           if (found != std::string::npos)
           {
             suffix = "";
           }
-          std::string usdLinkPath = usdModelPath + "/" + linkName + suffix;
-          auto linkPrim = stage->GetPrimAtPath(
-                pxr::SdfPath(usdLinkPath));
-          if (!linkPrim)
+          std::string usdvisualPath =
+            usdLinkPath + "/" + visualName + suffix;
+          auto visualPrim = stage->GetPrimAtPath(
+                pxr::SdfPath(usdvisualPath));
+          if (!visualPrim)
+          {
+            usdvisualPath =
+              usdLinkPath + "/" + visualName;
+            visualPrim = stage->GetPrimAtPath(
+                  pxr::SdfPath(usdvisualPath));
+          }
+          if (visualPrim)
           {
-            usdLinkPath = usdModelPath + "/" + linkName;
-            linkPrim = stage->GetPrimAtPath(
-                  pxr::SdfPath(usdLinkPath));
+            this->entities[visual.id()] = visualPrim;
+            this->entitiesByName[visualPrim.GetName()] = visual.id();
+            this->roles->Stamp(visualPrim, PrimRole::Visual, visual.id());
+            this->roles->Stamp(
+              visualPrim.GetChild(pxr::TfToken("geometry")),
+              PrimRole::Geometry, visual.id());
           }
-          if (linkPrim)
+        }
+        for (const auto &light : link.light())
+        {
+          std::string usdLightPath =
+            usdLinkPath + "/" + light.name();
+          auto lightPrim = stage->GetPrimAtPath(
+                pxr::SdfPath(usdLightPath));
+          if (lightPrim)
           {
-            this->entities[link.id()] = linkPrim;
-            this->entitiesByName[linkPrim.GetName()] = link.id();
-            for (const auto &visual : link.visual())
-            {
-              std::string visualName = visual.name();
-              std::string suffix = "_visual";
-              std::size_t found = visualName.find("_visual");
-              if (found != std::string::npos)
-              {
-                suffix = "";
-              }
-              std::string usdvisualPath =
-                usdLinkPath + "/" + visualName + suffix;
-              auto visualPrim = stage->GetPrimAtPath(
-                    pxr::SdfPath(usdvisualPath));
-              if (visualPrim)
-              {
-                this->entities[visual.id()] = visualPrim;
-                this->entitiesByName[visualPrim.GetName()] = visual.id();
-              }
-              else
-              {
-                usdvisualPath =
-                  usdLinkPath + "/" + visualName;
-                visualPrim = stage->GetPrimAtPath(
-                      pxr::SdfPath(usdvisualPath));
-                if (visualPrim)
-                {
-                  this->entities[visual.id()] = visualPrim;
-                  this->entitiesByName[visualPrim.GetName()] = visual.id();
-                }
-              }
-            }
-            for (const auto &light : link.light())
-            {
-              std::string usdLightPath =
-                usdLinkPath + "/" + light.name();
-              auto lightPrim = stage->GetPrimAtPath(
-                    pxr::SdfPath(usdLightPath));
-              if (lightPrim)
-              {
-                this->entities[light.id()] = lightPrim;
-                this->entitiesByName[lightPrim.GetName()] = light.id();
-              }
-            }
+            this->entities[light.id()] = lightPrim;
+            this->entitiesByName[lightPrim.GetName()] = light.id();
+            this->roles->Stamp(lightPrim, PrimRole::Light, light.id());
           }
         }
       }
     }
   }
 
-  std::replace(modelName.begin(), modelName.end(), ' ', '_');
-
-  std::string usdModelPath = "/" + worldName + "/" + modelName;
-
   this->entitiesByName[modelName] = _model.id();
 
   auto xform = pxr::UsdGeomXform::Define(*stage, pxr::SdfPath(usdModelPath));
@@ -767,6 +1033,7 @@ bool Scene::Implementation::UpdateModel(const ignition::msgs::Model &_model)
     this->ResetPose(xformApi);
   }
   this->entities[_model.id()] = xform.GetPrim();
+  this->roles->Stamp(xform.GetPrim(), PrimRole::Model, _model.id());
 
   for (const auto &link : _model.link())
   {
@@ -792,6 +1059,29 @@ bool Scene::Implementation::UpdateModel(const ignition::msgs::Model &_model)
 //////////////////////////////////////////////////
 bool Scene::Implementation::UpdateScene(const ignition::msgs::Scene &_scene)
 {
+  // the copies of the textures are named after their content, read them
+  // before the stage is locked. Finding them uses the system paths, which
+  // are only used under the lock.
+  std::vector<std::string> textures;
+  {
+    auto stage = this->stage->Lock();
+    for (const auto &model : _scene.model())
+    {
+      for (const auto &link : model.link())
+      {
+        for (const auto &visual : link.visual())
+        {
+          if (visual.has_material())
+          {
+            const auto paths = ResolveTextures(visual.material());
+            textures.insert(textures.end(), paths.begin(), paths.end());
+          }
+        }
+      }
+    }
+  }
+  HashTextures(textures);
+
   for (const auto &model : _scene.model())
   {
     if (!this->UpdateModel(model))
@@ -907,6 +1197,8 @@ bool Scene::Implementation::UpdateSensors(const ignition::msgs::Sensor &_sensor,
             << "] is not supported" << std::endl;
     return true;
   }
+  this->roles->Stamp(stage->GetPrimAtPath(pxr::SdfPath(_usdSensorPath)),
+                     PrimRole::Sensor, _sensor.id());
   return true;
 }
 //////////////////////////////////////////////////
@@ -918,6 +1210,7 @@ bool Scene::Implementation::UpdateLights(const ignition::msgs::Light &_light,
   auto stage = this->stage->Lock();
 
   const pxr::SdfPath sdfLightPath(_usdLightPath);
+  this->offline->Restore(*stage, sdfLightPath);
   switch (_light.type())
   {
     case ignition::msgs::Light::POINT:
@@ -965,6 +1258,7 @@ bool Scene::Implementation::UpdateLights(const ignition::msgs::Light &_light,
       .CreateAttribute(pxr::TfToken("intensity"), pxr::SdfValueTypeNames->Float,
                        false)
       .Set(usdLightIntensity);
+  this->roles->Stamp(lightPrim, PrimRole::Light, _light.id());
 
   return true;
 }
@@ -1055,10 +1349,24 @@ bool Scene::Init()
     ignmsg << "Subscribed to topic: [" << topic << "]" << std::endl;
   }
 
+  topic = "/world/" + this->dataPtr->worldName + "/visual_config";
+  if (!this->dataPtr->node.Subscribe(
+          topic, &Scene::Implementation::CallbackVisualConfig,
+          this->dataPtr.get()))
+  {
+    ignerr << "Error subscribing to topic [" << topic << "]" << std::endl;
+    return false;
+  }
+  else
+  {
+    ignmsg << "Subscribed to topic: [" << topic << "]" << std::endl;
+  }
+
   this->dataPtr->USDLayerNoticeListener =
     std::make_shared<FUSDLayerNoticeListener>(
       this->dataPtr->stage,
-      this->dataPtr->worldName);
+      this->dataPtr->worldName,
+      this->dataPtr->roles);
   auto LayerReloadKey = pxr::TfNotice::Register(
       pxr::TfCreateWeakPtr(this->dataPtr->USDLayerNoticeListener.get()),
       &FUSDLayerNoticeListener::HandleGlobalLayerReload);
@@ -1071,7 +1379,9 @@ bool Scene::Init()
     this->dataPtr->stage,
     this->dataPtr->worldName,
     this->dataPtr->simulatorPoses,
-    this->dataPtr->entitiesByName);
+    this->dataPtr->roles,
+    this->dataPtr->noticeBatchRate,
+    this->dataPtr->jointCommands);
   auto USDNoticeKey = pxr::TfNotice::Register(
       pxr::TfCreateWeakPtr(this->dataPtr->USDNoticeListener.get()),
       &FUSDNoticeListener::Handle);
@@ -1079,12 +1389,307 @@ bool Scene::Init()
 }
 
 //////////////////////////////////////////////////
-void Scene::Save() { this->Stage()->Lock()->Save(); }
+void Scene::Save()
+{
+  // the buffer is in memory only, the root layer is written by the replay
+  if (this->Offline())
+  {
+    return;
+  }
+  // the changes of the queued checkpoints are done, the ones queued from
+  // now on may not be in this save
+  std::vector<std::string> checkpoints;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->checkpointMutex);
+    checkpoints.swap(this->dataPtr->pendingCheckpoints);
+  }
+
+  // the layers are written once the request is done, don't wait for it
+  // with the stage locked
+  auto request = this->dataPtr->storage->Save(*this->Stage()->Lock());
+  const auto &result = request.Get();
+  if (!result)
+  {
+    ignerr << "Unable to save the stage: "
+           << omniClientGetResultString(result.Error()) << std::endl;
+    for (const auto &comment : checkpoints)
+    {
+      this->dataPtr->QueueCheckpoint(comment);
+    }
+    return;
+  }
+  for (const auto &comment : checkpoints)
+  {
+    this->dataPtr->checkpoints->Trigger(comment);
+  }
+}
+
+//////////////////////////////////////////////////
+void Scene::SetOffline(bool _offline)
+{
+  if (_offline)
+  {
+    this->dataPtr->offline->Begin();
+    return;
+  }
+  if (!this->dataPtr->offline->Active())
+  {
+    return;
+  }
+
+  // the meshes converted from now on write their payload right away. The
+  // meshes may be authored with the stage locked, lock it first.
+  std::unordered_map<std::string, MeshData> payloads;
+  OfflineBuffer::Stats stats;
+  {
+    auto stage = this->Stage()->Lock();
+    std::lock_guard<std::mutex> lock(this->dataPtr->payloadMutex);
+    stats = this->dataPtr->offline->Replay();
+    payloads.swap(this->dataPtr->pendingPayloads);
+  }
+  ignmsg << "Replayed the changes made while disconnected: [" << stats.prims
+         << "] new prims, [" << stats.properties << "] properties, ["
+         << stats.removals << "] removals in [" << stats.seconds * 1000
+         << " ms]" << std::endl;
+
+  std::size_t written = 0;
+  for (const auto &[url, mesh] : payloads)
+  {
+    auto layer = WriteMeshLayer(mesh, url);
+    if (!layer)
+    {
+      ignerr << layer.Error() << std::endl;
+      continue;
+    }
+    ++written;
+    // the stage may have loaded it while it was missing
+    auto stage = this->Stage()->Lock();
+    if (auto loaded = pxr::SdfLayer::Find(url))
+    {
+      loaded->Reload();
+    }
+  }
+  // the copies made while offline failed
+  const std::size_t textures = this->dataPtr->textureUploader->Retry();
+  ignmsg << "Wrote [" << written << "/" << payloads.size()
+         << "] mesh payloads and retried [" << textures
+         << "] texture uploads from while disconnected" << std::endl;
+  this->dataPtr->QueueCheckpoint("Reconnected");
+}
+
+//////////////////////////////////////////////////
+bool Scene::Offline() const { return this->dataPtr->offline->Active(); }
+
+//////////////////////////////////////////////////
+void Scene::LogStats()
+{
+  const auto meshStats = this->dataPtr->meshConverter->GetStats();
+  const std::size_t meshesProcessed = meshStats.completed + meshStats.failed;
+  if (meshStats.queueDepth > 0 || meshStats.inFlight > 0 ||
+      meshesProcessed != this->dataPtr->lastMeshesProcessed)
+  {
+    igndbg << "meshes: queued [" << meshStats.queueDepth << "] in flight ["
+           << meshStats.inFlight << "] completed [" << meshStats.completed
+           << "] failed [" << meshStats.failed << "] conversion mean/max ["
+           << meshStats.meanConversionMs << "/" << meshStats.maxConversionMs
+           << " ms] latency mean/max [" << meshStats.meanLatencyMs << "/"
+           << meshStats.maxLatencyMs << " ms]" << std::endl;
+    igndbg << "meshes source: resident [" << meshStats.sources.residentBytes
+           << " bytes] cached [" << meshStats.sources.cachedMeshes
+           << " meshes, " << meshStats.sources.cachedBytes
+           << " bytes] hits/misses [" << meshStats.sources.hits << "/"
+           << meshStats.sources.misses << "] evictions ["
+           << meshStats.sources.evictions << "]" << std::endl;
+    if (meshStats.weldVerticesIn > 0)
+    {
+      igndbg << "meshes weld: vertices [" << meshStats.weldVerticesIn
+             << " -> " << meshStats.weldVerticesOut << "] saved ["
+             << meshStats.weldBytesSaved << " bytes] degenerate triangles ["
+             << meshStats.weldTrianglesRemoved << "]" << std::endl;
+    }
+    if (meshStats.lodMeshes > 0)
+    {
+      igndbg << "meshes lod: meshes [" << meshStats.lodMeshes
+             << "] triangles [" << meshStats.lodTrianglesIn << " -> "
+             << meshStats.lodTrianglesOut << "] mean time ["
+             << meshStats.meanLodMs << " ms]" << std::endl;
+    }
+  }
+  this->dataPtr->lastMeshesProcessed = meshesProcessed;
+
+  const auto textureStats = this->dataPtr->textureUploader->GetStats();
+  const std::size_t texturesProcessed =
+      textureStats.completed + textureStats.failed + textureStats.skipped +
+      textureStats.existing;
+  if (textureStats.queued > 0 || textureStats.inFlight > 0 ||
+      texturesProcessed != this->dataPtr->lastTexturesProcessed)
+  {
+    igndbg << "textures: queued [" << textureStats.queued << "] in flight ["
+           << textureStats.inFlight << "] completed ["
+           << textureStats.completed << "] failed [" << textureStats.failed
+           << "] skipped [" << textureStats.skipped << "] already uploaded ["
+           << textureStats.existing << ", " << textureStats.existingBytes
+           << " bytes] upload mean/max ["
+           << textureStats.meanUploadMs << "/" << textureStats.maxUploadMs
+           << " ms]" << std::endl;
+  }
+  this->dataPtr->lastTexturesProcessed = texturesProcessed;
+
+  if (this->dataPtr->textureProcessor)
+  {
+    const auto processorStats = this->dataPtr->textureProcessor->GetStats();
+    const std::size_t processed = processorStats.processed +
+                                  processorStats.cacheHits +
+                                  processorStats.failed;
+    if (processorStats.queued > 0 ||
+        processed != this->dataPtr->lastTexturesResized)
+    {
+      igndbg << "textures processing: queued [" << processorStats.queued
+             << "] processed [" << processorStats.processed << "] resized ["
+             << processorStats.resized << "] cached ["
+             << processorStats.cacheHits << "] failed ["
+             << processorStats.failed << "] bytes saved ["
+             << processorStats.bytesIn - processorStats.bytesOut
+             << "] time mean/max [" << processorStats.meanProcessMs << "/"
+             << processorStats.maxProcessMs << " ms]" << std::endl;
+    }
+    this->dataPtr->lastTexturesResized = processed;
+  }
+
+  const std::size_t materialUpdates = this->dataPtr->materialUpdates;
+  if (materialUpdates != this->dataPtr->lastMaterialUpdates)
+  {
+    igndbg << "materials: updates [" << materialUpdates
+           << "] inputs written [" << this->dataPtr->materialInputsWritten
+           << "]" << std::endl;
+  }
+  this->dataPtr->lastMaterialUpdates = materialUpdates;
+
+  if (this->dataPtr->USDNoticeListener)
+  {
+    const auto noticeStats = this->dataPtr->USDNoticeListener->GetStats();
+    const std::size_t notices =
+        noticeStats.noticesReceived + noticeStats.noticesSuppressed;
+    if (notices != this->dataPtr->lastNoticesReceived)
+    {
+      igndbg << "usd notices: received [" << noticeStats.noticesReceived
+             << "] suppressed [" << noticeStats.noticesSuppressed
+             << "] batches [" << noticeStats.batchesProcessed
+             << "] paths processed [" << noticeStats.pathsProcessed
+             << "] pending [" << noticeStats.pendingPaths << "]" << std::endl;
+    }
+    this->dataPtr->lastNoticesReceived = notices;
+  }
+
+  if (this->dataPtr->checkpoints)
+  {
+    const auto checkpointStats = this->dataPtr->checkpoints->GetStats();
+    const std::size_t checkpoints =
+        checkpointStats.created + checkpointStats.failed;
+    if (checkpoints != this->dataPtr->lastCheckpointsCreated)
+    {
+      igndbg << "checkpoints: created [" << checkpointStats.created
+             << "] failed [" << checkpointStats.failed << "] merged ["
+             << checkpointStats.merged << "] last ["
+             << checkpointStats.lastCheckpoint << "]" << std::endl;
+    }
+    this->dataPtr->lastCheckpointsCreated = checkpoints;
+  }
+
+  if (this->dataPtr->USDLayerNoticeListener)
+  {
+    const auto removalStats =
+        this->dataPtr->USDLayerNoticeListener->GetStats();
+    // removals finish after being submitted
+    const std::size_t activity =
+        removalStats.submitted + removalStats.removed + removalStats.failed;
+    if (removalStats.pending > 0 ||
+        activity != this->dataPtr->lastRemovalsActivity)
+    {
+      igndbg << "removals in ignition: submitted [" << removalStats.submitted
+             << "] skipped [" << removalStats.skipped << "] removed ["
+             << removalStats.removed << "] failed [" << removalStats.failed
+             << "] pending [" << removalStats.pending << "] batches ["
+             << removalStats.batches << "]" << std::endl;
+    }
+    this->dataPtr->lastRemovalsActivity = activity;
+  }
+
+  const PoseSender *poseSender =
+      this->dataPtr->USDNoticeListener
+          ? this->dataPtr->USDNoticeListener->Poses()
+          : nullptr;
+  if (poseSender)
+  {
+    const auto poseStats = poseSender->GetStats();
+    if (poseStats.pending > 0 ||
+        poseStats.submitted != this->dataPtr->lastPosesSubmitted)
+    {
+      igndbg << "poses to ignition: submitted [" << poseStats.submitted
+             << "] merged [" << poseStats.merged << "] dropped ["
+             << poseStats.dropped << "] pending [" << poseStats.pending
+             << "] requests [" << poseStats.requests << "] failed ["
+             << poseStats.failedRequests << "] round trip mean/max ["
+             << poseStats.meanRoundTripMs << "/" << poseStats.maxRoundTripMs
+             << " ms]" << std::endl;
+    }
+    this->dataPtr->lastPosesSubmitted = poseStats.submitted;
+  }
+
+  const EntitySpawner *spawner =
+      this->dataPtr->USDNoticeListener
+          ? this->dataPtr->USDNoticeListener->Spawner()
+          : nullptr;
+  if (spawner)
+  {
+    const auto spawnStats = spawner->GetStats();
+    const std::size_t finished = spawnStats.spawned + spawnStats.failed;
+    if (spawnStats.pending > 0 ||
+        finished != this->dataPtr->lastSpawnsFinished)
+    {
+      igndbg << "spawns in ignition: submitted [" << spawnStats.submitted
+             << "] merged [" << spawnStats.merged << "] spawned ["
+             << spawnStats.spawned << "] failed [" << spawnStats.failed
+             << "] pending [" << spawnStats.pending << "] requests ["
+             << spawnStats.requests << "] failed requests ["
+             << spawnStats.failedRequests << "] round trip mean/max ["
+             << spawnStats.meanRoundTripMs << "/"
+             << spawnStats.maxRoundTripMs << " ms]" << std::endl;
+    }
+    this->dataPtr->lastSpawnsFinished = finished;
+  }
+
+  const MeshExporter *meshExporter =
+      this->dataPtr->USDNoticeListener
+          ? this->dataPtr->USDNoticeListener->ExportedMeshes()
+          : nullptr;
+  if (meshExporter)
+  {
+    const auto exportStats = meshExporter->GetStats();
+    const std::size_t exports =
+        exportStats.exported + exportStats.cacheHits + exportStats.failed;
+    if (exports != this->dataPtr->lastMeshesExported)
+    {
+      igndbg << "meshes to ignition: exported [" << exportStats.exported
+             << "] cache hits [" << exportStats.cacheHits << "] failed ["
+             << exportStats.failed << "] written ["
+             << exportStats.bytesWritten << " bytes]" << std::endl;
+    }
+    this->dataPtr->lastMeshesExported = exports;
+  }
+}
 
 //////////////////////////////////////////////////
 /// \brief Function called each time a topic update is received.
 void Scene::Implementation::CallbackPoses(const ignition::msgs::Pose_V &_msg)
 {
+  if (this->checkpoints)
+  {
+    this->checkpoints->OnSimTime(_msg.header().stamp().sec() +
+                                 _msg.header().stamp().nsec() * 1e-9);
+  }
+
+  AuthoringGuard authoring;
   for (const auto &poseMsg : _msg.pose())
   {
     try
@@ -1108,6 +1713,7 @@ void Scene::Implementation::CallbackPoses(const ignition::msgs::Pose_V &_msg)
 /// \brief Function called each time a topic update is received.
 void Scene::Implementation::CallbackJoint(const ignition::msgs::Model &_msg)
 {
+  AuthoringGuard authoring;
   // this->UpdateModel(_msg);
   for (const auto &joint : _msg.joint())
   {
@@ -1122,13 +1728,42 @@ void Scene::Implementation::CallbackJoint(const ignition::msgs::Model &_msg)
 //////////////////////////////////////////////////
 void Scene::Implementation::CallbackScene(const ignition::msgs::Scene &_scene)
 {
+  AuthoringGuard authoring;
+  // the scene lists the models already in the stage too
+  std::vector<uint32_t> newModels;
+  {
+    auto stage = this->stage->Lock();
+    for (const auto &model : _scene.model())
+    {
+      if (this->entities.count(model.id()) == 0)
+      {
+        newModels.push_back(model.id());
+      }
+    }
+  }
+
   this->UpdateScene(_scene);
+
+  bool created = false;
+  {
+    auto stage = this->stage->Lock();
+    for (const auto id : newModels)
+    {
+      created = created || this->entities.count(id) > 0;
+    }
+  }
+  if (created)
+  {
+    this->QueueCheckpoint("Models added");
+  }
 }
 
 //////////////////////////////////////////////////
 void Scene::Implementation::CallbackSceneDeletion(
     const ignition::msgs::UInt32_V &_msg)
 {
+  AuthoringGuard authoring;
+  bool removed = false;
   for (const auto id : _msg.data())
   {
     try
@@ -1136,10 +1771,29 @@ void Scene::Implementation::CallbackSceneDeletion(
       auto stage = this->stage->Lock();
       const auto &prim = this->entities.at(id);
       std::string primName = prim.GetName();
-      stage->RemovePrim(prim.GetPath());
-      ignmsg << "Removed [" << prim.GetPath() << "]" << std::endl;
+      const pxr::SdfPath path = prim.GetPath();
+      this->offline->RemovePrim(*stage, path);
+      this->roles->Remove(path);
+      ignmsg << "Removed [" << path << "]" << std::endl;
       this->entities.erase(id);
       this->entitiesByName.erase(primName);
+      removed = true;
+
+      // The materials of the visuals are in "/Looks", remove the ones whose
+      // visual is gone with the entity
+      for (auto updater = this->materialUpdaters.begin();
+           updater != this->materialUpdaters.end();)
+      {
+        auto visual = this->entities.find(updater->first);
+        if (visual != this->entities.end() && visual->second.IsValid() &&
+            visual->second.IsActive())
+        {
+          ++updater;
+          continue;
+        }
+        this->offline->RemovePrim(*stage, updater->second->GetPath());
+        updater = this->materialUpdaters.erase(updater);
+      }
     }
     catch (const std::out_of_range &)
     {
@@ -1147,6 +1801,83 @@ void Scene::Implementation::CallbackSceneDeletion(
               << std::endl;
     }
   }
+  if (removed)
+  {
+    this->QueueCheckpoint("Models removed");
+  }
+}
+
+//////////////////////////////////////////////////
+void Scene::Implementation::QueueCheckpoint(const std::string &_comment)
+{
+  if (!this->checkpoints || !this->checkpointOnChanges)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(this->checkpointMutex);
+  // they are merged into one checkpoint anyway
+  if (std::find(this->pendingCheckpoints.begin(),
+                this->pendingCheckpoints.end(),
+                _comment) == this->pendingCheckpoints.end())
+  {
+    this->pendingCheckpoints.push_back(_comment);
+  }
+}
+
+//////////////////////////////////////////////////
+void Scene::Implementation::CallbackVisualConfig(
+    const ignition::msgs::Visual &_msg)
+{
+  AuthoringGuard authoring;
+  if (!_msg.has_material())
+  {
+    return;
+  }
+  std::vector<std::string> textures;
+  {
+    auto stage = this->stage->Lock();
+    textures = ResolveTextures(_msg.material());
+  }
+  HashTextures(textures);
+
+  auto stage = this->stage->Lock();
+  auto updater = this->materialUpdaters.find(_msg.id());
+  if (updater != this->materialUpdaters.end() && !updater->second->IsValid())
+  {
+    this->materialUpdaters.erase(updater);
+    updater = this->materialUpdaters.end();
+  }
+  if (updater == this->materialUpdaters.end())
+  {
+    auto entity = this->entities.find(_msg.id());
+    if (entity == this->entities.end() || !entity->second.IsValid())
+    {
+      ignwarn << "Failed to update material, cannot find visual ["
+              << _msg.name() << " - " << _msg.id() << "]" << std::endl;
+      return;
+    }
+    // Meshes may still be converting, their geometry is authored later
+    pxr::UsdGeomGprim gprim(
+      entity->second.GetChild(pxr::TfToken("geometry")));
+    if (!gprim)
+    {
+      return;
+    }
+    // The material of the visual may be shared, give it its own material
+    // so that other visuals are not changed.
+    updater = this->materialUpdaters
+                  .emplace(_msg.id(),
+                           std::make_unique<MaterialUpdater>(
+                             gprim,
+                             "/Looks/Visual_" + std::to_string(_msg.id()),
+                             *stage, this->stageDirUrl,
+                             *this->textureUploader,
+                             this->textureProcessor.get()))
+                  .first;
+  }
+
+  this->materialInputsWritten += updater->second->Update(_msg.material());
+  ++this->materialUpdates;
 }
 }  // namespace omniverse
 }  // namespace ignition
@@ -18,6 +18,7 @@
 #define IGNITION_OMNIVERSE_SCENE_HPP
 
 #include "Error.hpp"
+#include "StorageBackend.hpp"
 #include "ThreadSafe.hpp"
 
 #include <ignition/utils/ImplPtr.hh>
@@ -42,6 +43,7 @@
 #include <pxr/usd/usdShade/material.h>
 #include <pxr/usd/usdGeom/xformCommonAPI.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -55,22 +57,124 @@ namespace omniverse
 
 enum class Simulator : int { Ignition, IsaacSim };
 
+/// \brief How the joint positions coming from IsaacSim are sent to Ignition
+enum class JointCommands : int
+{
+  /// \brief One `msgs::Double` per joint on
+  /// "/model/<model>/joint/<joint>/0/cmd_pos", for JointPositionController
+  PerJoint,
+  /// \brief One `msgs::JointTrajectory` with all the joints on
+  /// "/model/<model>/joint_trajectory", for JointTrajectoryController
+  Trajectory
+};
+
+/// \brief Tuning options of the scene
+struct SceneOptions
+{
+  /// \brief Number of threads converting meshes, 0 converts them in the
+  /// thread that receives the scene.
+  unsigned int meshWorkers = 2;
+
+  /// \brief Maximum number of meshes waiting for a worker. When the queue is
+  /// full meshes are converted in the thread that receives the scene.
+  std::size_t meshQueueDepth = 64;
+
+  /// \brief Bytes of source meshes kept in memory after their conversion,
+  /// for other visuals of the same file. 0 releases them right away.
+  std::size_t meshCacheBytes = 256 * 1024 * 1024;
+
+  /// \brief Merge duplicated vertices of meshes before authoring them.
+  bool meshWeld = false;
+
+  /// \brief Vertices whose attributes are within this distance are merged,
+  /// 0 merges only bitwise identical vertices.
+  float meshWeldEpsilon = 0;
+
+  /// \brief Meshes with more triangles than this get simplified levels of
+  /// detail, authored as a "LOD" variant set. 0 disables it.
+  std::size_t meshLodTriangleBudget = 0;
+
+  /// \brief Number of levels of detail, including the original mesh.
+  unsigned int meshLodLevels = 3;
+
+  /// \brief Maximum number of textures copied to the stage directory at
+  /// once, the others wait in a queue.
+  unsigned int textureUploads = 4;
+
+  /// \brief PNG textures larger than this are downscaled before their
+  /// upload. 0 uploads textures as they are.
+  unsigned int textureMaxResolution = 0;
+
+  /// \brief Number of threads downscaling textures.
+  unsigned int textureWorkers = 2;
+
+  /// \brief Write the geometry of each mesh to its own layer, next to the
+  /// stage in "payloads/", and reference it with a payload arc.
+  bool meshPayloads = false;
+
+  /// \brief Load the payloads when opening the stage. The bridge authors
+  /// the payload layers directly, so it doesn't need them loaded.
+  bool loadPayloads = true;
+
+  /// \brief Maximum number of times per second the changes made by other
+  /// clients of the stage are processed. Changes made in between are
+  /// merged.
+  double noticeBatchRate = 60;
+
+  /// \brief How the joint positions coming from IsaacSim are sent
+  JointCommands jointCommands = JointCommands::PerJoint;
+
+  /// \brief Storage of the files of the stage, null uses the omniclient
+  /// library
+  std::shared_ptr<StorageBackend> storage;
+
+  /// \brief Seconds of wall clock time between checkpoints of the stage,
+  /// 0 disables them.
+  double checkpointInterval = 0;
+
+  /// \brief Seconds of simulation time between checkpoints of the stage,
+  /// 0 disables them.
+  double checkpointSimInterval = 0;
+
+  /// \brief Checkpoint the stage when models are added or removed, once
+  /// the next `Save` has written them
+  bool checkpointOnChanges = false;
+
+  /// \brief Minimum seconds of wall clock time between two checkpoints
+  double checkpointMinSpacing = 10;
+};
+
 class Scene
 {
  public:
   Scene(
     const std::string &_worldName,
     const std::string &_stageUrl,
-    Simulator _simulatorPoses);
+    Simulator _simulatorPoses,
+    const SceneOptions &_options = SceneOptions());
 
   /// \brief Initialize the scene and subscribes for updates. This blocks until
   /// the scene is initialized.
   /// \return true if success
   bool Init();
 
-  /// \brief Equivalent to `scene.Stage().Lock()->Save()`.
+  /// \brief Save the stage through the storage backend, waiting for it
+  /// without the stage lock. Does nothing while offline.
   void Save();
 
+  /// \brief Switch between buffering the changes in memory, while the
+  /// server is unreachable, and writing them to the stage. Going back
+  /// online replays the buffered changes. See `OfflineBuffer`.
+  /// \param[in] _offline true when the connection is lost
+  void SetOffline(bool _offline);
+
+  /// \brief Whether the changes are buffered in memory
+  bool Offline() const;
+
+  /// \brief Print the statistics of the background work, only when there
+  /// was some activity since the last call.
+  void LogStats();
+
   std::shared_ptr<ThreadSafe<pxr::UsdStageRefPtr>> &Stage();
 
   /// \internal
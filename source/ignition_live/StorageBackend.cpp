@@ -0,0 +1,574 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "StorageBackend.hpp"
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Util.hh>
+
+#include <OmniClient.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ignition::omniverse
+{
+//////////////////////////////////////////////////
+OmniverseRequest<OmniverseEntry> OmniClientBackend::Stat(
+  const std::string &_url)
+{
+  return OmniverseAsync::Stat(_url);
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::vector<OmniverseEntry>> OmniClientBackend::List(
+  const std::string &_url)
+{
+  return OmniverseAsync::List(_url);
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::string> OmniClientBackend::Copy(
+  const std::string &_src, const std::string &_dst)
+{
+  return OmniverseAsync::Copy(_src, _dst);
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::string> OmniClientBackend::Checkpoint(
+  const std::string &_url, const std::string &_comment)
+{
+  return OmniverseAsync::Checkpoint(_url, _comment);
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<OmniverseServerInfo> OmniClientBackend::ServerInfo(
+  const std::string &_url)
+{
+  return OmniverseAsync::ServerInfo(_url);
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::string> OmniClientBackend::Save(
+  const pxr::UsdStageRefPtr &_stage)
+{
+  _stage->Save();
+  auto state = std::make_shared<OmniverseRequest<std::string>::State>();
+  state->Fulfill(_stage->GetRootLayer()->GetIdentifier());
+  return OmniverseRequest<std::string>(state, nullptr);
+}
+
+//////////////////////////////////////////////////
+std::string OmniClientBackend::ResolveUrl(const std::string &_url) const
+{
+  // omniUsdLiveSetModeForUrl() keys off of the _normalized_ stage url
+  size_t bufferSize = 0;
+  omniClientNormalizeUrl(_url.c_str(), nullptr, &bufferSize);
+  std::string normalized(bufferSize, '\0');
+  const char *result =
+      omniClientNormalizeUrl(_url.c_str(), normalized.data(), &bufferSize);
+  if (!result)
+  {
+    return _url;
+  }
+  return std::string(result);
+}
+
+class LocalStorageBackend::Implementation
+{
+ public:
+  struct Job
+  {
+    std::function<void()> run;
+    /// \brief Fulfill the request without running it
+    std::function<void()> cancel;
+  };
+
+  template <typename T>
+  using Work = std::function<typename OmniverseRequest<T>::Result(
+    const std::atomic<bool> &)>;
+
+  ~Implementation();
+
+  void Worker();
+
+  /// \brief Queue a request on the pool of workers
+  /// \param[in] _work function computing the result, with the flag set when
+  /// the request is canceled
+  template <typename T>
+  OmniverseRequest<T> Submit(Work<T> _work);
+
+  /// \brief Sleep for the simulated duration of a request
+  /// \param[in] _bytes bytes transferred by the request
+  /// \return false if the request was canceled in the meantime
+  bool Delay(std::uintmax_t _bytes, const std::atomic<bool> &_canceled) const;
+
+  /// \brief Local path of a url
+  std::filesystem::path ToPath(const std::string &_url) const;
+
+  /// \brief Entry of a local file
+  static OmniverseEntry ToEntry(const std::filesystem::path &_path);
+
+  Options options;
+  std::vector<std::thread> workers;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Job> queue;
+  std::size_t requests = 0;
+  std::size_t failed = 0;
+  std::size_t canceled = 0;
+  std::size_t bytesCopied = 0;
+  std::size_t checkpoints = 0;
+  bool stop = false;
+};
+
+//////////////////////////////////////////////////
+LocalStorageBackend::Implementation::~Implementation()
+{
+  std::deque<Job> queued;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+    queued.swap(this->queue);
+  }
+  this->cv.notify_all();
+  for (auto &job : queued)
+  {
+    job.cancel();
+  }
+  for (auto &worker : this->workers)
+  {
+    worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void LocalStorageBackend::Implementation::Worker()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock,
+                    [this] { return this->stop || !this->queue.empty(); });
+      if (this->stop)
+      {
+        return;
+      }
+      job = std::move(this->queue.front());
+      this->queue.pop_front();
+    }
+    job.run();
+  }
+}
+
+//////////////////////////////////////////////////
+template <typename T>
+OmniverseRequest<T> LocalStorageBackend::Implementation::Submit(Work<T> _work)
+{
+  using Request = OmniverseRequest<T>;
+  auto state = std::make_shared<typename Request::State>();
+  auto canceled = std::make_shared<std::atomic<bool>>(false);
+
+  Job job;
+  job.run = [this, state, canceled, work = std::move(_work)]
+  {
+    auto result = work(*canceled);
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (*canceled)
+      {
+        // `Cancel` fulfilled it already
+        ++this->canceled;
+        return;
+      }
+      if (!result)
+      {
+        ++this->failed;
+      }
+    }
+    // the continuations may start other requests
+    state->Fulfill(result);
+  };
+  job.cancel = [state]
+  {
+    state->Fulfill(typename Request::Result(eOmniClientResult_ErrorCanceled));
+  };
+
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->stop)
+    {
+      lock.unlock();
+      job.cancel();
+      return Request(state, nullptr);
+    }
+    this->queue.push_back(std::move(job));
+    ++this->requests;
+  }
+  this->cv.notify_one();
+  return Request(state, [canceled] { *canceled = true; });
+}
+
+//////////////////////////////////////////////////
+bool LocalStorageBackend::Implementation::Delay(
+  std::uintmax_t _bytes, const std::atomic<bool> &_canceled) const
+{
+  double ms = this->options.latencyMs;
+  if (this->options.bandwidthBytesPerSec > 0)
+  {
+    ms += 1000.0 * _bytes / this->options.bandwidthBytesPerSec;
+  }
+  const auto end =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(ms));
+  // wake up regularly to stop early when canceled
+  const auto slice = std::chrono::milliseconds(10);
+  while (!_canceled)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= end)
+    {
+      return true;
+    }
+    std::this_thread::sleep_for(
+      std::min<std::chrono::steady_clock::duration>(end - now, slice));
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+std::filesystem::path LocalStorageBackend::Implementation::ToPath(
+  const std::string &_url) const
+{
+  static const std::string fileScheme = "file://";
+  if (_url.compare(0, fileScheme.size(), fileScheme) == 0)
+  {
+    return _url.substr(fileScheme.size());
+  }
+  const auto scheme = _url.find("://");
+  if (scheme == std::string::npos)
+  {
+    return _url;
+  }
+  // "<host>/<path>" below the root
+  return std::filesystem::path(this->options.root) /
+         _url.substr(scheme + 3);
+}
+
+//////////////////////////////////////////////////
+OmniverseEntry LocalStorageBackend::Implementation::ToEntry(
+  const std::filesystem::path &_path)
+{
+  std::error_code ec;
+  OmniverseEntry entry;
+  entry.relativePath = _path.filename().string();
+  if (std::filesystem::is_regular_file(_path, ec))
+  {
+    entry.size = std::filesystem::file_size(_path, ec);
+  }
+  const auto modified = std::filesystem::last_write_time(_path, ec);
+  if (!ec)
+  {
+    entry.modifiedTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             modified.time_since_epoch())
+                             .count();
+  }
+  return entry;
+}
+
+//////////////////////////////////////////////////
+LocalStorageBackend::LocalStorageBackend(const Options &_options)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->options = _options;
+  for (unsigned int i = 0; i < std::max(1u, _options.workers); ++i)
+  {
+    this->dataPtr->workers.emplace_back(&Implementation::Worker,
+                                        this->dataPtr.get());
+  }
+}
+
+//////////////////////////////////////////////////
+LocalStorageBackend::~LocalStorageBackend() = default;
+
+//////////////////////////////////////////////////
+OmniverseRequest<OmniverseEntry> LocalStorageBackend::Stat(
+  const std::string &_url)
+{
+  using Result = OmniverseRequest<OmniverseEntry>::Result;
+  auto *impl = this->dataPtr.get();
+  const auto path = impl->ToPath(_url);
+  return impl->Submit<OmniverseEntry>(
+    [impl, path](const std::atomic<bool> &_canceled) -> Result
+    {
+      if (!impl->Delay(0, _canceled))
+      {
+        return eOmniClientResult_ErrorCanceled;
+      }
+      std::error_code ec;
+      if (!std::filesystem::exists(path, ec))
+      {
+        return eOmniClientResult_ErrorNotFound;
+      }
+      return Implementation::ToEntry(path);
+    });
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::vector<OmniverseEntry>> LocalStorageBackend::List(
+  const std::string &_url)
+{
+  using Entries = std::vector<OmniverseEntry>;
+  using Result = OmniverseRequest<Entries>::Result;
+  auto *impl = this->dataPtr.get();
+  const auto path = impl->ToPath(_url);
+  return impl->Submit<Entries>(
+    [impl, path](const std::atomic<bool> &_canceled) -> Result
+    {
+      if (!impl->Delay(0, _canceled))
+      {
+        return eOmniClientResult_ErrorCanceled;
+      }
+      std::error_code ec;
+      std::filesystem::directory_iterator it(path, ec);
+      if (ec)
+      {
+        return eOmniClientResult_ErrorNotFound;
+      }
+      Entries entries;
+      for (; it != std::filesystem::directory_iterator(); it.increment(ec))
+      {
+        entries.push_back(Implementation::ToEntry(it->path()));
+      }
+      return entries;
+    });
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::string> LocalStorageBackend::Copy(
+  const std::string &_src, const std::string &_dst)
+{
+  using Result = OmniverseRequest<std::string>::Result;
+  auto *impl = this->dataPtr.get();
+  const auto src = impl->ToPath(_src);
+  const auto dst = impl->ToPath(_dst);
+  return impl->Submit<std::string>(
+    [impl, src, dst, url = _dst](const std::atomic<bool> &_canceled) -> Result
+    {
+      std::error_code ec;
+      const auto bytes = std::filesystem::file_size(src, ec);
+      if (ec)
+      {
+        return eOmniClientResult_ErrorNotFound;
+      }
+      if (!impl->Delay(bytes, _canceled))
+      {
+        return eOmniClientResult_ErrorCanceled;
+      }
+      std::filesystem::create_directories(dst.parent_path(), ec);
+      std::filesystem::copy_file(
+        src, dst, std::filesystem::copy_options::overwrite_existing, ec);
+      if (ec)
+      {
+        ignerr << "Unable to copy [" << src << "] to [" << dst
+               << "]: " << ec.message() << std::endl;
+        return eOmniClientResult_Error;
+      }
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      impl->bytesCopied += bytes;
+      return url;
+    });
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::string> LocalStorageBackend::Checkpoint(
+  const std::string &_url, const std::string &_comment)
+{
+  using Result = OmniverseRequest<std::string>::Result;
+  auto *impl = this->dataPtr.get();
+  const auto path = impl->ToPath(_url);
+  return impl->Submit<std::string>(
+    [impl, path, _comment](const std::atomic<bool> &_canceled) -> Result
+    {
+      std::error_code ec;
+      const auto bytes = std::filesystem::file_size(path, ec);
+      if (ec)
+      {
+        return eOmniClientResult_ErrorNotFound;
+      }
+      if (!impl->Delay(bytes, _canceled))
+      {
+        return eOmniClientResult_ErrorCanceled;
+      }
+
+      // checkpoints are numbered from 1, like on the server
+      const auto dir =
+          path.parent_path() / ".checkpoints" / path.filename();
+      std::filesystem::create_directories(dir, ec);
+      std::size_t number = 1;
+      for (std::filesystem::directory_iterator it(dir, ec);
+           !ec && it != std::filesystem::directory_iterator();
+           it.increment(ec))
+      {
+        ++number;
+      }
+      const auto checkpoint =
+          dir / (std::to_string(number) + path.extension().string());
+      std::filesystem::copy_file(path, checkpoint, ec);
+      if (ec)
+      {
+        ignerr << "Unable to checkpoint [" << path << "]: " << ec.message()
+               << std::endl;
+        return eOmniClientResult_Error;
+      }
+      igndbg << "Checkpoint [" << checkpoint << "]: " << _comment
+             << std::endl;
+
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      ++impl->checkpoints;
+      return "?&" + std::to_string(number);
+    });
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<OmniverseServerInfo> LocalStorageBackend::ServerInfo(
+  const std::string &)
+{
+  using Result = OmniverseRequest<OmniverseServerInfo>::Result;
+  auto *impl = this->dataPtr.get();
+  return impl->Submit<OmniverseServerInfo>(
+    [impl](const std::atomic<bool> &_canceled) -> Result
+    {
+      if (!impl->Delay(0, _canceled))
+      {
+        return eOmniClientResult_ErrorCanceled;
+      }
+      OmniverseServerInfo info;
+      info.version = "local";
+      ignition::common::env("USER", info.username);
+      info.connectionId = "local";
+      info.checkpointsEnabled = true;
+      return info;
+    });
+}
+
+//////////////////////////////////////////////////
+OmniverseRequest<std::string> LocalStorageBackend::Save(
+  const pxr::UsdStageRefPtr &_stage)
+{
+  using Result = OmniverseRequest<std::string>::Result;
+  auto *impl = this->dataPtr.get();
+
+  // pairs of exported and destination files
+  std::vector<std::pair<std::filesystem::path, std::filesystem::path>> files;
+  bool exported = true;
+  for (const auto &layer : _stage->GetUsedLayers())
+  {
+    if (!layer->IsDirty() || layer->IsAnonymous())
+    {
+      continue;
+    }
+    // keep the extension, it is the format of the layer
+    const std::filesystem::path dst = layer->GetRealPath();
+    const std::filesystem::path tmp =
+        dst.parent_path() /
+        (dst.stem().string() + ".saving" + dst.extension().string());
+    if (!layer->Export(tmp.string()))
+    {
+      ignerr << "Unable to export layer [" << layer->GetIdentifier()
+             << "] to [" << tmp << "]" << std::endl;
+      exported = false;
+      continue;
+    }
+    files.emplace_back(tmp, dst);
+  }
+
+  return impl->Submit<std::string>(
+    [impl, files, exported,
+     url = _stage->GetRootLayer()->GetIdentifier()](
+      const std::atomic<bool> &_canceled) -> Result
+    {
+      std::error_code ec;
+      std::uintmax_t bytes = 0;
+      for (const auto &file : files)
+      {
+        bytes += std::filesystem::file_size(file.first, ec);
+      }
+      const bool delayed = impl->Delay(bytes, _canceled);
+      bool saved = exported && delayed;
+      for (const auto &[tmp, dst] : files)
+      {
+        if (delayed)
+        {
+          std::filesystem::rename(tmp, dst, ec);
+          if (!ec)
+          {
+            continue;
+          }
+          ignerr << "Unable to save [" << dst << "]: " << ec.message()
+                 << std::endl;
+          saved = false;
+        }
+        std::filesystem::remove(tmp, ec);
+      }
+      if (!delayed)
+      {
+        return eOmniClientResult_ErrorCanceled;
+      }
+      if (!saved)
+      {
+        return eOmniClientResult_Error;
+      }
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      impl->bytesCopied += bytes;
+      return url;
+    });
+}
+
+//////////////////////////////////////////////////
+std::string LocalStorageBackend::ResolveUrl(const std::string &_url) const
+{
+  return this->dataPtr->ToPath(_url).string();
+}
+
+//////////////////////////////////////////////////
+LocalStorageBackend::Stats LocalStorageBackend::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  Stats stats;
+  stats.requests = this->dataPtr->requests;
+  stats.failed = this->dataPtr->failed;
+  stats.canceled = this->dataPtr->canceled;
+  stats.bytesCopied = this->dataPtr->bytesCopied;
+  stats.checkpoints = this->dataPtr->checkpoints;
+  return stats;
+}
+}  // namespace ignition::omniverse
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_STORAGEBACKEND_HPP
+#define IGNITION_OMNIVERSE_STORAGEBACKEND_HPP
+
+#include "OmniClientpp.hpp"
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <pxr/usd/usd/stage.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ignition::omniverse
+{
+/// \brief Where the stage and its files are stored.
+/// \details All the requests are asynchronous, see `OmniverseRequest`.
+class StorageBackend
+{
+ public:
+  virtual ~StorageBackend() = default;
+
+  virtual OmniverseRequest<OmniverseEntry> Stat(const std::string& _url) = 0;
+
+  /// \brief List the entries of a folder
+  virtual OmniverseRequest<std::vector<OmniverseEntry>> List(
+    const std::string& _url) = 0;
+
+  /// \brief Copy a file, overwriting the destination
+  /// \return The url of the destination
+  virtual OmniverseRequest<std::string> Copy(const std::string& _src,
+                                             const std::string& _dst) = 0;
+
+  /// \brief Create a checkpoint of a file
+  /// \return The query of the checkpoint, to append to the url
+  virtual OmniverseRequest<std::string> Checkpoint(
+    const std::string& _url, const std::string& _comment) = 0;
+
+  virtual OmniverseRequest<OmniverseServerInfo> ServerInfo(
+    const std::string& _url) = 0;
+
+  /// \brief Write the changed layers of a stage. The layers are read before
+  /// it returns, the caller must hold the stage lock until then but not
+  /// until the request is done.
+  /// \return The url of the root layer
+  virtual OmniverseRequest<std::string> Save(
+    const pxr::UsdStageRefPtr& _stage) = 0;
+
+  /// \brief Url that USD opens for a url of this backend
+  virtual std::string ResolveUrl(const std::string& _url) const = 0;
+};
+
+/// \brief Storage on an Omniverse server, through the omniclient library
+class OmniClientBackend : public StorageBackend
+{
+ public:
+  OmniverseRequest<OmniverseEntry> Stat(const std::string& _url) override;
+
+  OmniverseRequest<std::vector<OmniverseEntry>> List(
+    const std::string& _url) override;
+
+  OmniverseRequest<std::string> Copy(const std::string& _src,
+                                     const std::string& _dst) override;
+
+  OmniverseRequest<std::string> Checkpoint(
+    const std::string& _url, const std::string& _comment) override;
+
+  OmniverseRequest<OmniverseServerInfo> ServerInfo(
+    const std::string& _url) override;
+
+  /// \brief Saves the stage through USD, it is done once it returns
+  OmniverseRequest<std::string> Save(
+    const pxr::UsdStageRefPtr& _stage) override;
+
+  /// \brief The url normalized by the omniclient library
+  std::string ResolveUrl(const std::string& _url) const override;
+};
+
+/// \brief Storage in a local directory, which doesn't need an Omniverse
+/// server, to benchmark the bridge on machines without one.
+/// \details "omniverse://<host>/<path>" urls are stored in
+/// "<root>/<host>/<path>", "file://" urls and paths are used as they are.
+/// The requests run on a pool of threads. Every request is delayed by a
+/// fixed latency, and copies and saves also by their size over a bandwidth,
+/// to get reproducible timings.
+class LocalStorageBackend : public StorageBackend
+{
+ public:
+  struct Options
+  {
+    /// \brief Directory of the files of the omniverse urls
+    std::string root;
+
+    /// \brief Time added to every request
+    double latencyMs = 0;
+
+    /// \brief Simulated bandwidth of the copies in bytes per second, 0 is
+    /// unlimited.
+    double bandwidthBytesPerSec = 0;
+
+    /// \brief Number of requests running at once
+    unsigned int workers = 4;
+  };
+
+  struct Stats
+  {
+    std::size_t requests = 0;
+    std::size_t failed = 0;
+    std::size_t canceled = 0;
+    std::size_t bytesCopied = 0;
+    std::size_t checkpoints = 0;
+  };
+
+  explicit LocalStorageBackend(const Options& _options);
+
+  /// \brief Waits for the running requests, the queued ones are canceled.
+  ~LocalStorageBackend() override;
+
+  OmniverseRequest<OmniverseEntry> Stat(const std::string& _url) override;
+
+  OmniverseRequest<std::vector<OmniverseEntry>> List(
+    const std::string& _url) override;
+
+  OmniverseRequest<std::string> Copy(const std::string& _src,
+                                     const std::string& _dst) override;
+
+  /// \brief Checkpoints are copies of the file, in the ".checkpoints"
+  /// folder next to it
+  OmniverseRequest<std::string> Checkpoint(
+    const std::string& _url, const std::string& _comment) override;
+
+  OmniverseRequest<OmniverseServerInfo> ServerInfo(
+    const std::string& _url) override;
+
+  /// \brief The layers are exported next to their file right away, they
+  /// replace it once delayed like a copy of their size
+  OmniverseRequest<std::string> Save(
+    const pxr::UsdStageRefPtr& _stage) override;
+
+  /// \brief The local path of the url
+  std::string ResolveUrl(const std::string& _url) const override;
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "TextureProcessor.hpp"
+
+#include "Metrics.hpp"
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Image.hh>
+#include <ignition/common/Util.hh>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ignition::omniverse
+{
+class TextureProcessor::Implementation
+{
+ public:
+  struct Job
+  {
+    std::string src;
+    std::string name;
+    Callback callback;
+  };
+
+  ~Implementation();
+
+  void Worker();
+
+  /// \brief Process a texture
+  /// \return The file to upload
+  std::string Process(const Job &_job);
+
+  Options options;
+
+  /// \brief FreeImage is initialized by the first image and released with
+  /// the last one, keep one alive for as long as the workers run so they
+  /// never race to initialize or release it
+  ignition::common::Image freeImage;
+
+  std::vector<std::thread> workers;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Job> queue;
+  bool stop = false;
+  std::size_t processed = 0;
+  std::size_t resized = 0;
+  std::size_t cacheHits = 0;
+  std::size_t failed = 0;
+  std::size_t bytesIn = 0;
+  std::size_t bytesOut = 0;
+
+  DurationStat processTime;
+};
+
+//////////////////////////////////////////////////
+TextureProcessor::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->cv.notify_all();
+  for (auto &worker : this->workers)
+  {
+    worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void TextureProcessor::Implementation::Worker()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock, [this] { return this->stop || !this->queue.empty(); });
+      if (this->stop)
+      {
+        return;
+      }
+      job = std::move(this->queue.front());
+      this->queue.pop_front();
+    }
+    job.callback(this->Process(job));
+  }
+}
+
+//////////////////////////////////////////////////
+std::string TextureProcessor::Implementation::Process(const Job &_job)
+{
+  const std::string cached =
+      ignition::common::joinPaths(this->options.cacheDir, _job.name);
+  std::error_code ec;
+  if (std::filesystem::exists(cached, ec))
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->cacheHits;
+    return cached;
+  }
+
+  ScopedTimer timer(this->processTime);
+  ignition::common::Image image;
+  if (image.Load(_job.src) != 0 || !image.Valid())
+  {
+    ignwarn << "Unable to load texture [" << _job.src
+            << "], uploading it as is" << std::endl;
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->failed;
+    return _job.src;
+  }
+
+  const unsigned int srcWidth = image.Width();
+  const unsigned int srcHeight = image.Height();
+  const unsigned int size = std::max(srcWidth, srcHeight);
+  if (size <= this->options.maxResolution)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->processed;
+    return _job.src;
+  }
+
+  const double scale = static_cast<double>(this->options.maxResolution) / size;
+  const int width = std::max(1, static_cast<int>(srcWidth * scale));
+  const int height = std::max(1, static_cast<int>(srcHeight * scale));
+  image.Rescale(width, height);
+
+  // write to a temporary file first so that other workers, or a later run,
+  // never see a partial texture in the cache
+  std::filesystem::create_directories(this->options.cacheDir, ec);
+  const std::string tmp =
+      cached + ".tmp" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  image.SavePNG(tmp);
+  std::filesystem::rename(tmp, cached, ec);
+  if (ec)
+  {
+    ignwarn << "Unable to cache texture [" << cached << "]: " << ec.message()
+            << ", uploading [" << _job.src << "] as is" << std::endl;
+    std::filesystem::remove(tmp, ec);
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ++this->failed;
+    return _job.src;
+  }
+
+  const auto srcBytes = std::filesystem::file_size(_job.src, ec);
+  const auto dstBytes = std::filesystem::file_size(cached, ec);
+  igndbg << "Resized texture [" << _job.src << "] from [" << srcWidth
+         << "x" << srcHeight << "] to [" << width << "x" << height
+         << "], [" << srcBytes << " -> " << dstBytes << " bytes]" << std::endl;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  ++this->processed;
+  ++this->resized;
+  if (!ec)
+  {
+    this->bytesIn += srcBytes;
+    this->bytesOut += dstBytes;
+  }
+  return cached;
+}
+
+//////////////////////////////////////////////////
+TextureProcessor::TextureProcessor(const Options &_options)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->options = _options;
+  for (unsigned int i = 0; i < std::max(1u, _options.workers); ++i)
+  {
+    this->dataPtr->workers.emplace_back(&Implementation::Worker,
+                                        this->dataPtr.get());
+  }
+}
+
+//////////////////////////////////////////////////
+bool TextureProcessor::Handles(const std::string &_path) const
+{
+  const auto dot = _path.rfind('.');
+  return dot != std::string::npos &&
+         ignition::common::lowercase(_path.substr(dot + 1)) == "png";
+}
+
+//////////////////////////////////////////////////
+unsigned int TextureProcessor::MaxResolution() const
+{
+  return this->dataPtr->options.maxResolution;
+}
+
+//////////////////////////////////////////////////
+void TextureProcessor::Submit(const std::string &_src,
+                              const std::string &_name, Callback _callback)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    this->dataPtr->queue.push_back({_src, _name, std::move(_callback)});
+  }
+  this->dataPtr->cv.notify_one();
+}
+
+//////////////////////////////////////////////////
+TextureProcessor::Stats TextureProcessor::GetStats() const
+{
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    stats.queued = this->dataPtr->queue.size();
+    stats.processed = this->dataPtr->processed;
+    stats.resized = this->dataPtr->resized;
+    stats.cacheHits = this->dataPtr->cacheHits;
+    stats.failed = this->dataPtr->failed;
+    stats.bytesIn = this->dataPtr->bytesIn;
+    stats.bytesOut = this->dataPtr->bytesOut;
+  }
+  stats.meanProcessMs = this->dataPtr->processTime.MeanMs();
+  stats.maxProcessMs = this->dataPtr->processTime.MaxMs();
+  return stats;
+}
+}  // namespace ignition::omniverse
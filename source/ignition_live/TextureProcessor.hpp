@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_TEXTUREPROCESSOR_HPP
+#define IGNITION_OMNIVERSE_TEXTUREPROCESSOR_HPP
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Downscales textures larger than a maximum resolution before they
+/// are uploaded.
+/// \details Textures are processed in a pool of worker threads and the
+/// results are cached on disk by name, the caller is expected to put the
+/// hash of the source in it. Only PNG textures are processed, they are
+/// re-encoded as PNG.
+class TextureProcessor
+{
+ public:
+  struct Options
+  {
+    /// \brief Number of worker threads
+    unsigned int workers = 2;
+
+    /// \brief Textures whose width or height is larger are downscaled,
+    /// keeping their aspect ratio
+    unsigned int maxResolution = 2048;
+
+    /// \brief Local directory where the processed textures are cached
+    std::string cacheDir;
+  };
+
+  struct Stats
+  {
+    std::size_t queued = 0;
+    std::size_t processed = 0;
+    std::size_t resized = 0;
+    std::size_t cacheHits = 0;
+    std::size_t failed = 0;
+    /// \brief Size of the resized textures, before and after
+    std::size_t bytesIn = 0;
+    std::size_t bytesOut = 0;
+    /// \brief Time spent loading, resizing and saving a texture
+    double meanProcessMs = 0;
+    double maxProcessMs = 0;
+  };
+
+  /// \brief Called from a worker with the file to upload, either the
+  /// processed texture or the source if it didn't need processing.
+  using Callback = std::function<void(const std::string&)>;
+
+  explicit TextureProcessor(const Options& _options);
+
+  /// \brief Whether a texture would be processed, based on its extension
+  bool Handles(const std::string& _path) const;
+
+  /// \brief Maximum resolution of the processed textures
+  unsigned int MaxResolution() const;
+
+  /// \brief Queue a texture, returns immediately.
+  /// \param[in] _src path of the texture
+  /// \param[in] _name name of the processed texture in the cache, it must
+  /// change with the contents of `_src`
+  /// \param[in] _callback called with the file to upload
+  void Submit(const std::string& _src, const std::string& _name,
+              Callback _callback);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "TextureUploader.hpp"
+
+#include "Metrics.hpp"
+
+#include <ignition/common/Console.hh>
+
+#include <OmniClient.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ignition::omniverse
+{
+class TextureUploader::Implementation
+{
+ public:
+  struct Job
+  {
+    std::string src;
+    std::string dst;
+  };
+
+  /// \brief Start copies, `mutex` must not be locked because the copies
+  /// may complete before they are started.
+  void Start(const std::vector<Job> &_jobs);
+
+  /// \brief Copy the file unless the destination exists
+  void OnStatDone(const Job &_job, DurationStat::Clock::time_point _start,
+                  const OmniverseRequest<OmniverseEntry>::Result &_result);
+
+  void StartCopy(const Job &_job, DurationStat::Clock::time_point _start);
+
+  void OnCopyDone(const Job &_job, DurationStat::Clock::time_point _start,
+                  const OmniverseRequest<std::string>::Result &_result);
+
+  /// \brief Take the queued jobs that can start without exceeding
+  /// `maxInFlight`, `mutex` must be locked.
+  std::vector<Job> TakeStartable();
+
+  /// \brief Record the end of a copy and start the next ones
+  void Finish(const Job &_job, Status _status);
+
+  std::shared_ptr<StorageBackend> storage;
+  unsigned int maxInFlight = 1;
+  bool skipExisting = false;
+
+  mutable std::mutex mutex;
+  std::condition_variable idle;
+  std::deque<Job> queue;
+  std::unordered_map<std::string, Status> status;
+  /// \brief Uploads that failed, by destination
+  std::unordered_map<std::string, Job> failedJobs;
+  std::size_t inFlight = 0;
+  std::size_t completed = 0;
+  std::size_t failed = 0;
+  std::size_t skipped = 0;
+  std::size_t existing = 0;
+  std::size_t existingBytes = 0;
+
+  DurationStat uploadTime;
+};
+
+//////////////////////////////////////////////////
+std::vector<TextureUploader::Implementation::Job>
+TextureUploader::Implementation::TakeStartable()
+{
+  std::vector<Job> jobs;
+  while (this->inFlight < this->maxInFlight && !this->queue.empty())
+  {
+    jobs.push_back(std::move(this->queue.front()));
+    this->queue.pop_front();
+    this->status[jobs.back().dst] = Status::Uploading;
+    ++this->inFlight;
+  }
+  return jobs;
+}
+
+//////////////////////////////////////////////////
+void TextureUploader::Implementation::Start(const std::vector<Job> &_jobs)
+{
+  for (const auto &job : _jobs)
+  {
+    const auto start = DurationStat::Clock::now();
+    if (this->skipExisting)
+    {
+      this->storage->Stat(job.dst).OnDone(
+        [this, job, start](const auto &_result)
+        { this->OnStatDone(job, start, _result); });
+    }
+    else
+    {
+      this->StartCopy(job, start);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void TextureUploader::Implementation::OnStatDone(
+  const Job &_job, DurationStat::Clock::time_point _start,
+  const OmniverseRequest<OmniverseEntry>::Result &_result)
+{
+  if (_result)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      ++this->existing;
+      this->existingBytes += _result.Value().size;
+    }
+    this->Finish(_job, Status::Done);
+    return;
+  }
+  this->StartCopy(_job, _start);
+}
+
+//////////////////////////////////////////////////
+void TextureUploader::Implementation::StartCopy(
+  const Job &_job, DurationStat::Clock::time_point _start)
+{
+  this->storage->Copy(_job.src, _job.dst).OnDone(
+    [this, _job, _start](const auto &_result)
+    { this->OnCopyDone(_job, _start, _result); });
+}
+
+//////////////////////////////////////////////////
+void TextureUploader::Implementation::OnCopyDone(
+  const Job &_job, DurationStat::Clock::time_point _start,
+  const OmniverseRequest<std::string>::Result &_result)
+{
+  this->uploadTime.Add(DurationStat::Clock::now() - _start);
+  if (!_result)
+  {
+    ignerr << "Failed to upload texture [" << _job.dst
+           << "]: " << omniClientGetResultString(_result.Error())
+           << std::endl;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (_result)
+    {
+      ++this->completed;
+    }
+    else
+    {
+      ++this->failed;
+    }
+  }
+  this->Finish(_job, _result ? Status::Done : Status::Failed);
+}
+
+//////////////////////////////////////////////////
+void TextureUploader::Implementation::Finish(const Job &_job, Status _status)
+{
+  std::vector<Job> jobs;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    --this->inFlight;
+    this->status[_job.dst] = _status;
+    if (_status == Status::Failed)
+    {
+      this->failedJobs[_job.dst] = _job;
+    }
+    jobs = this->TakeStartable();
+    if (this->inFlight == 0)
+    {
+      this->idle.notify_all();
+    }
+  }
+  this->Start(jobs);
+}
+
+//////////////////////////////////////////////////
+TextureUploader::TextureUploader(unsigned int _maxInFlight,
+                                 bool _skipExisting,
+                                 std::shared_ptr<StorageBackend> _storage)
+    : dataPtr(ignition::utils::MakeUniqueImpl<Implementation>())
+{
+  this->dataPtr->storage =
+      _storage ? std::move(_storage) : std::make_shared<OmniClientBackend>();
+  this->dataPtr->maxInFlight = std::max(1u, _maxInFlight);
+  this->dataPtr->skipExisting = _skipExisting;
+}
+
+//////////////////////////////////////////////////
+TextureUploader::~TextureUploader()
+{
+  std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->queue.clear();
+  // the continuations of the running copies use the implementation
+  this->dataPtr->idle.wait(lock,
+                           [this] { return this->dataPtr->inFlight == 0; });
+}
+
+//////////////////////////////////////////////////
+void TextureUploader::Upload(const std::string &_src, const std::string &_dst)
+{
+  std::vector<Implementation::Job> jobs;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    auto &status = this->dataPtr->status[_dst];
+    if (status == Status::Queued || status == Status::Uploading ||
+        status == Status::Done)
+    {
+      ++this->dataPtr->skipped;
+      return;
+    }
+    status = Status::Queued;
+    this->dataPtr->queue.push_back({_src, _dst});
+    jobs = this->dataPtr->TakeStartable();
+  }
+  this->dataPtr->Start(jobs);
+}
+
+//////////////////////////////////////////////////
+std::size_t TextureUploader::Retry()
+{
+  std::size_t retried = 0;
+  std::vector<Implementation::Job> jobs;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    for (auto &[dst, job] : this->dataPtr->failedJobs)
+    {
+      // it may have been uploaded again since
+      auto &status = this->dataPtr->status[dst];
+      if (status != Status::Failed)
+      {
+        continue;
+      }
+      status = Status::Queued;
+      this->dataPtr->queue.push_back(std::move(job));
+      ++retried;
+    }
+    this->dataPtr->failedJobs.clear();
+    jobs = this->dataPtr->TakeStartable();
+  }
+  this->dataPtr->Start(jobs);
+  return retried;
+}
+
+//////////////////////////////////////////////////
+TextureUploader::Status TextureUploader::GetStatus(
+  const std::string &_dst) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  auto it = this->dataPtr->status.find(_dst);
+  return it == this->dataPtr->status.end() ? Status::Unknown : it->second;
+}
+
+//////////////////////////////////////////////////
+bool TextureUploader::WaitIdle(std::chrono::milliseconds _timeout)
+{
+  std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->idle.wait_for(
+      lock, _timeout,
+      [this]
+      { return this->dataPtr->inFlight == 0 && this->dataPtr->queue.empty(); });
+}
+
+//////////////////////////////////////////////////
+TextureUploader::Stats TextureUploader::GetStats() const
+{
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    stats.queued = this->dataPtr->queue.size();
+    stats.inFlight = this->dataPtr->inFlight;
+    stats.completed = this->dataPtr->completed;
+    stats.failed = this->dataPtr->failed;
+    stats.skipped = this->dataPtr->skipped;
+    stats.existing = this->dataPtr->existing;
+    stats.existingBytes = this->dataPtr->existingBytes;
+  }
+  stats.meanUploadMs = this->dataPtr->uploadTime.MeanMs();
+  stats.maxUploadMs = this->dataPtr->uploadTime.MaxMs();
+  return stats;
+}
+}  // namespace ignition::omniverse
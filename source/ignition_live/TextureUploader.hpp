@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IGNITION_OMNIVERSE_TEXTUREUPLOADER_HPP
+#define IGNITION_OMNIVERSE_TEXTUREUPLOADER_HPP
+
+#include "StorageBackend.hpp"
+
+#include <ignition/utils/ImplPtr.hh>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace ignition::omniverse
+{
+/// \brief Copies textures to the stage directory in the background.
+/// \details Copies go through a `StorageBackend`, by default the
+/// omniclient library, so the destination can be an omniverse or a
+/// `file://` url. At most `_maxInFlight` copies run at
+/// once, the others wait in a queue. A destination is copied only once,
+/// unless its previous copy failed.
+/// With `_skipExisting`, destinations that already exist are not copied
+/// again. This is meant for content addressed destinations, whose name
+/// changes with their content.
+class TextureUploader
+{
+ public:
+  enum class Status
+  {
+    /// \brief The destination was never submitted
+    Unknown,
+    Queued,
+    Uploading,
+    Done,
+    Failed
+  };
+
+  struct Stats
+  {
+    std::size_t queued = 0;
+    std::size_t inFlight = 0;
+    std::size_t completed = 0;
+    std::size_t failed = 0;
+    /// \brief Uploads skipped because the destination was already copied or
+    /// being copied
+    std::size_t skipped = 0;
+    /// \brief Uploads skipped because the destination already existed, and
+    /// the bytes that didn't need to be transferred
+    std::size_t existing = 0;
+    std::size_t existingBytes = 0;
+    /// \brief Time from the start of a copy until it completes
+    double meanUploadMs = 0;
+    double maxUploadMs = 0;
+  };
+
+  /// \param[in] _maxInFlight Maximum number of copies running at once
+  /// \param[in] _skipExisting Check if the destinations exist before
+  /// copying them
+  /// \param[in] _storage storage of the destinations, null uses the
+  /// omniclient library
+  explicit TextureUploader(unsigned int _maxInFlight,
+                           bool _skipExisting = false,
+                           std::shared_ptr<StorageBackend> _storage = nullptr);
+
+  /// \brief Waits for the running copies, the queued ones are dropped.
+  ~TextureUploader();
+
+  /// \brief Queue the copy of a file, returns immediately.
+  /// \param[in] _src url or path of the file to copy
+  /// \param[in] _dst url of the copy
+  void Upload(const std::string& _src, const std::string& _dst);
+
+  /// \brief Queue again the uploads that failed, e.g. once the connection
+  /// to the server is back.
+  /// \return The number of uploads queued
+  std::size_t Retry();
+
+  /// \brief Status of the last upload to `_dst`
+  Status GetStatus(const std::string& _dst) const;
+
+  /// \brief Block until there is nothing queued or running.
+  /// \return false if it timed out
+  bool WaitIdle(std::chrono::milliseconds _timeout);
+
+  Stats GetStats() const;
+
+  /// \internal
+  /// \brief Private data pointer
+  IGN_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+};
+}  // namespace ignition::omniverse
+
+#endif
@@ -31,12 +31,15 @@
 #include <pxr/usd/usd/prim.h>
 #include <pxr/usd/usdGeom/xformCommonAPI.h>
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 
 using namespace ignition::omniverse;
 
 constexpr double kTargetFps = 60;
 constexpr std::chrono::duration<double> kUpdateRate(1 / kTargetFps);
+constexpr std::chrono::seconds kMinReconnectDelay(1);
 
 int main(int argc, char* argv[])
 {
@@ -60,10 +63,123 @@ int main(int argc, char* argv[])
   app.add_option("--pose", simulatorPoses, "Which simulator will handle the poses")
       ->required()
       ->transform(CLI::CheckedTransformer(map, CLI::ignore_case));;
+  ignition::omniverse::SceneOptions sceneOptions;
+  app.add_option("--mesh-workers", sceneOptions.meshWorkers,
+                 "Number of threads converting meshes, 0 converts them "
+                 "synchronously (default 2)");
+  app.add_option("--mesh-queue", sceneOptions.meshQueueDepth,
+                 "Maximum number of meshes waiting for a conversion thread "
+                 "(default 64)");
+  std::size_t meshCacheMb = sceneOptions.meshCacheBytes / (1024 * 1024);
+  app.add_option("--mesh-cache-mb", meshCacheMb,
+                 "Megabytes of source meshes kept in memory after their "
+                 "conversion, 0 releases them right away (default 256)");
+  app.add_flag("--mesh-weld", sceneOptions.meshWeld,
+               "Merge duplicated vertices of meshes before authoring them");
+  app.add_option("--mesh-weld-epsilon", sceneOptions.meshWeldEpsilon,
+                 "Vertices whose position, uv and normal are within this "
+                 "distance are merged, 0 merges only identical vertices "
+                 "(default 0)")
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--mesh-lod-budget", sceneOptions.meshLodTriangleBudget,
+                 "Meshes with more triangles get simplified levels of "
+                 "detail, 0 disables it (default 0)");
+  app.add_option("--mesh-lod-levels", sceneOptions.meshLodLevels,
+                 "Number of levels of detail, including the original mesh "
+                 "(default 3)")
+      ->check(CLI::Range(2, 4));
+  app.add_option("--texture-uploads", sceneOptions.textureUploads,
+                 "Maximum number of textures copied to the stage at once "
+                 "(default 4)")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--texture-max-size", sceneOptions.textureMaxResolution,
+                 "PNG textures larger than this are downscaled before their "
+                 "upload, 0 uploads them as they are (default 0)");
+  app.add_option("--texture-workers", sceneOptions.textureWorkers,
+                 "Number of threads downscaling textures (default 2)")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--mesh-payloads", sceneOptions.meshPayloads,
+               "Write the geometry of meshes to their own layers, loaded "
+               "through payloads");
+  app.add_flag_callback(
+      "--no-load-payloads",
+      [&sceneOptions]() { sceneOptions.loadPayloads = false; },
+      "Don't load the payloads when opening the stage");
+  app.add_option("--notice-rate", sceneOptions.noticeBatchRate,
+                 "Maximum number of times per second the changes made by "
+                 "other clients of the stage are processed (default 60)")
+      ->check(CLI::PositiveNumber);
+  std::map<std::string, ignition::omniverse::JointCommands> jointCommandsMap{
+    {"joint", ignition::omniverse::JointCommands::PerJoint},
+    {"trajectory", ignition::omniverse::JointCommands::Trajectory}};
+  app.add_option("--joint-commands", sceneOptions.jointCommands,
+                 "How the joint positions from IsaacSim are sent: \"joint\" "
+                 "publishes each joint on its cmd_pos topic, \"trajectory\" "
+                 "publishes all of them on joint_trajectory, for the "
+                 "JointTrajectoryController system (default joint)")
+      ->transform(CLI::CheckedTransformer(jointCommandsMap, CLI::ignore_case));
+  app.add_option("--checkpoint-interval", sceneOptions.checkpointInterval,
+                 "Seconds between checkpoints of the stage, 0 disables "
+                 "them (default 0)")
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--checkpoint-sim-interval",
+                 sceneOptions.checkpointSimInterval,
+                 "Seconds of simulation time between checkpoints of the "
+                 "stage, 0 disables them (default 0)")
+      ->check(CLI::NonNegativeNumber);
+  app.add_flag("--checkpoint-on-changes", sceneOptions.checkpointOnChanges,
+               "Checkpoint the stage when models are added or removed");
+  app.add_option("--checkpoint-min-spacing",
+                 sceneOptions.checkpointMinSpacing,
+                 "Minimum seconds between two checkpoints (default 10)")
+      ->check(CLI::NonNegativeNumber);
+  std::string storageName = "omniverse";
+  app.add_option("--storage", storageName,
+                 "Where the stage is stored: \"omniverse\" on a Nucleus "
+                 "server, or \"local\" in a local directory, to benchmark "
+                 "without a server (default omniverse)")
+      ->check(CLI::IsMember({"omniverse", "local"}, CLI::ignore_case));
+  LocalStorageBackend::Options localOptions;
+  localOptions.root = ".";
+  app.add_option("--local-root", localOptions.root,
+                 "Directory of the omniverse urls with the local storage, "
+                 "\"omniverse://<host>/<path>\" is stored in "
+                 "\"<root>/<host>/<path>\" (default .)");
+  app.add_option("--local-latency-ms", localOptions.latencyMs,
+                 "Simulated latency of the requests to the local storage "
+                 "(default 0)")
+      ->check(CLI::NonNegativeNumber);
+  double localBandwidthMbps = 0;
+  app.add_option("--local-bandwidth-mbps", localBandwidthMbps,
+                 "Simulated bandwidth of the copies and saves to the local "
+                 "storage in megabits per second, 0 is unlimited (default 0)")
+      ->check(CLI::NonNegativeNumber);
+  bool reconnect = false;
+  app.add_flag("--reconnect", reconnect,
+               "Keep running when the connection to the server is lost, the "
+               "changes are buffered in memory and replayed once it is back "
+               "(by default the bridge exits)");
+  double reconnectMaxDelay = 30;
+  app.add_option("--reconnect-max-delay", reconnectMaxDelay,
+                 "Maximum seconds between two reconnection attempts, the "
+                 "delay doubles after each attempt (default 30)")
+      ->check(CLI::PositiveNumber);
   app.add_flag_callback("-v,--verbose",
                         []() { ignition::common::Console::SetVerbosity(4); });
 
   CLI11_PARSE(app, argc, argv);
+  sceneOptions.meshCacheBytes = meshCacheMb * 1024 * 1024;
+  const bool localStorage = ignition::common::lowercase(storageName) == "local";
+  if (localStorage)
+  {
+    localOptions.bandwidthBytesPerSec = localBandwidthMbps * 1e6 / 8;
+    sceneOptions.storage =
+        std::make_shared<LocalStorageBackend>(localOptions);
+  }
+  else
+  {
+    sceneOptions.storage = std::make_shared<OmniClientBackend>();
+  }
 
   std::string ignGazeboResourcePath;
   auto systemPaths = ignition::common::systemPaths();
@@ -75,16 +191,21 @@ int main(int argc, char* argv[])
   }
 
   // Connect with omniverse
-  if (!StartOmniverse())
+  ConnectionState connection;
+  if (!localStorage && !StartOmniverse(reconnect ? &connection : nullptr))
   {
     ignerr << "Not able to start Omniverse" << std::endl;
     return -1;
   }
 
+  // runs while the stage is created
+  const auto serverInfo = sceneOptions.storage->ServerInfo(destinationPath);
+
   // Open the USD model in Omniverse
   const std::string stageUrl = [&]()
   {
-    auto result = CreateOmniverseModel(destinationPath);
+    auto result =
+        CreateOmniverseModel(destinationPath, *sceneOptions.storage);
     if (!result)
     {
       ignerr << result.Error() << std::endl;
@@ -93,12 +214,15 @@ int main(int argc, char* argv[])
     return result.Value();
   }();
 
-  omniUsdLiveSetModeForUrl(stageUrl.c_str(),
-                           OmniUsdLiveMode::eOmniUsdLiveModeEnabled);
+  if (!localStorage)
+  {
+    omniUsdLiveSetModeForUrl(stageUrl.c_str(),
+                             OmniUsdLiveMode::eOmniUsdLiveModeEnabled);
+  }
 
-  PrintConnectedUsername(stageUrl);
+  PrintConnectedUsername(serverInfo);
 
-  Scene scene(worldName, stageUrl, simulatorPoses);
+  Scene scene(worldName, stageUrl, simulatorPoses, sceneOptions);
   if (!scene.Init())
   {
     return -1;
@@ -108,6 +232,9 @@ int main(int argc, char* argv[])
   // don't spam the console, show the fps only once a sec
   auto nextShowFps =
       lastUpdate.time_since_epoch() + std::chrono::duration<double>(1);
+  // backoff of the reconnection attempts while the connection is lost
+  std::chrono::steady_clock::duration reconnectDelay = kMinReconnectDelay;
+  auto nextReconnect = lastUpdate;
 
   while (true)
   {
@@ -120,11 +247,41 @@ int main(int argc, char* argv[])
           1 / std::chrono::duration<double>(now - lastUpdate).count();
       nextShowFps = now.time_since_epoch() + std::chrono::duration<double>(1);
       igndbg << "fps: " << curFps << std::endl;
+      scene.LogStats();
     }
     lastUpdate = now;
 
+    if (!connection.connected)
+    {
+      if (!scene.Offline())
+      {
+        scene.SetOffline(true);
+        reconnectDelay = kMinReconnectDelay;
+        nextReconnect = now + reconnectDelay;
+      }
+      else if (now >= nextReconnect)
+      {
+        ignmsg << "Reconnecting to [" << stageUrl << "]" << std::endl;
+        omniClientReconnect(stageUrl.c_str());
+        reconnectDelay = std::min(
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            reconnectDelay * 2),
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(reconnectMaxDelay)));
+        nextReconnect = now + reconnectDelay;
+      }
+      continue;
+    }
+    if (scene.Offline())
+    {
+      scene.SetOffline(false);
+    }
+
     scene.Save();
-    omniUsdLiveProcess();
+    if (!localStorage)
+    {
+      omniUsdLiveProcess();
+    }
   }
 
   return 0;